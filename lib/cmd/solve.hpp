@@ -1,11 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
 #include <cobalt.hpp>
 
 #define RECOVER_FROM_EXCEPTIONS 	0
 #define DEBUG_MODE
 
 #include <common/logger.hpp>
+#include <common/cancellation.hpp>
 
 #include <equations/equations.hpp>
 #include <tensor/expression_database.hpp>
@@ -29,7 +37,10 @@ namespace Construction {
             }
 
             void RegisterFlags() {
-                AddLocalFlag<int>(parallelEqns, "parallel", "p", 1, "Number of equations that are solved in parallel");
+                AddLocalFlag<int>(parallelEqns, "parallel", "p", 0, "Maximal number of independent equations that are solved in parallel, 0 for no limit");
+                AddLocalFlag<int>(numThreads, "threads", "t", 0, "Number of threads N for the calculations and for the coefficient and equation jobs each, i.e. at most 2N threads, 0 for one per hardware thread");
+                AddLocalFlag<int>(timeLimit, "timeout", "T", 0, "Time limit in seconds for the calculation of a single coefficient or equation, 0 for no limit");
+                AddLocalFlag<int>(memoryLimit, "memory", "m", 0, "Memory limit in megabytes by which the process may grow during the calculation of a single coefficient or equation, 0 for no limit");
                 AddLocalFlag<bool>(abc, "abc", "a", false, "Do not print the full tensors but only the scalars in front of base tensors");
                 AddLocalFlag<bool>(colored, "colored", "c", false, "Prettify the output");
             }
@@ -49,6 +60,12 @@ namespace Construction {
                 // Add options for debugging
                 Construction::Equations::SubstitutionManager::Instance()->SetMaxTickets(parallelEqns);
 
+                // Size the shared task pool before anything is calculated
+                Construction::Parallel::GlobalTaskPool::SetNumberOfThreads(numThreads > 0 ? numThreads : 0);
+
+                // Pathological coefficients and equations are aborted, the others are kept
+                Construction::Common::CancellationToken::SetBudget(std::chrono::seconds(std::max(timeLimit, 0)), std::max(memoryLimit, 0));
+
                 if (Lookup<bool>("debug")) {
                     logger.SetDebugLevel("screen", Construction::Common::DebugLevel::DEBUG);
                 }
@@ -88,7 +105,7 @@ namespace Construction {
                 }
 
                 // Calculate number of coefficients and equations
-                int numberOfSteps = equations.size() + 8 * Construction::Equations::Coefficients::Instance()->Size();
+                int numberOfSteps = equations.size() + Construction::Equations::Coefficient::GetNumberOfSteps() * Construction::Equations::Coefficients::Instance()->Size();
 
                 // Create progress bar
                 Construction::Common::ProgressBar progress (numberOfSteps, 100);
@@ -120,8 +137,8 @@ namespace Construction {
                     eq->Wait();
                 }
 
-                // Print the result
-                int offset = 0;
+                // Aborted coefficients and equations skip their steps
+                progress.Stop();
 
                 // Clean the line
                 for (int i=0; i<200; i++) {
@@ -129,14 +146,34 @@ namespace Construction {
                 }
                 std::cerr << "\r";
 
-                // Collect all the variables in the coefficients
-                std::vector<Construction::Tensor::Scalar> variables;
+                // Wait for the remaining coefficients, s.t. no task of the pool blocks on them
+                std::vector<Construction::Equations::Coefficients::Definition> keys;
+                std::vector<Construction::Tensor::Tensor> tensors;
+                std::vector<bool> aborted;
                 for (auto it = Construction::Equations::Coefficients::Instance()->begin(); it != Construction::Equations::Coefficients::Instance()->end(); ++it) {
-                    auto tensor = *it->second->Get();
-                    auto stuff = tensor.ExtractVariables();
-                    for (auto& pair : stuff) {
-                        auto _it = std::find(variables.begin(), variables.end(), pair.first);
-                        if (_it == variables.end()) variables.push_back(pair.first);
+                    auto tensor = it->second->Get();
+
+                    keys.push_back(it->first);
+                    tensors.push_back(tensor ? *tensor : Construction::Tensor::Tensor::Zero());
+                    aborted.push_back(tensor == nullptr);
+                }
+
+                auto pool = Construction::Parallel::GlobalTaskPool::Instance();
+
+                // Collect all the variables in the coefficients in the order of their first occurence
+                auto variablesOfCoefficients = pool->ParallelMap<std::vector<Construction::Tensor::Scalar>>(tensors, [](const Construction::Tensor::Tensor& tensor) {
+                    std::vector<Construction::Tensor::Scalar> result;
+                    for (auto& pair : tensor.ExtractVariables()) {
+                        result.push_back(pair.first);
+                    }
+                    return result;
+                }, 1);
+
+                std::vector<Construction::Tensor::Scalar> variables;
+                std::unordered_set<Construction::Tensor::Scalar> seen;
+                for (auto& vars : variablesOfCoefficients) {
+                    for (auto& variable : vars) {
+                        if (seen.insert(variable).second) variables.push_back(variable);
                     }
                 }
 
@@ -147,129 +184,155 @@ namespace Construction {
                     substitution.Insert(variable, Construction::Tensor::Scalar::Variable("e", pos++));
                 }
 
-                // Print the results
-                if (!abc) {
-                    for (auto it = Construction::Equations::Coefficients::Instance()->begin(); it != Construction::Equations::Coefficients::Instance()->end(); ++it) {
-                    //auto tensor = it->second->Get()->RedefineVariables("e", offset);
-                    //auto tensor = substitution(*it->second->GetAsync()).CollectByVariables();
-                    auto tensor = substitution(*it->second->GetAsync());//.Simplify();
+                // Format the results in parallel and print them in order
+                std::vector<std::string> results (tensors.size());
+                pool->ParallelFor(0, tensors.size(), [&](size_t i) {
+                    if (aborted[i]) {
+                        results[i] = FormatAborted(keys[i]);
+                        return;
+                    }
+
+                    results[i] = abc ? FormatCoefficientABC(keys[i], substitution(tensors[i]).Simplify(), i+1)
+                                     : FormatCoefficient(keys[i], substitution(tensors[i]));
+                }, 1);
+
+                for (auto& result : results) {
+                    std::cout << result;
+                }
+                std::cout << std::flush;
+
+                // Finally check all the coefficients
+                /*
+                {
+                    Construction::Logger::Debug("Run a final test ...");
+                    int violations = 0;
+                    for (auto &eq : equations) {
+                        Construction::Tensor::Tensor result;
 
-                    auto summands = tensor.GetSummands();
+                        // Check the equation
+                        auto correct = eq->Test(&result);
 
-                    if (!tensor.IsZeroTensor()) {
-                        offset += summands.size();
+                        if (!correct) {
+                            Construction::Logger::Error("Equation `", eq->ToLaTeX(), "` is violated.\nFound ", result);
+                            ++violations;
+                        }
                     }
+                    Construction::Logger::Debug("Found ", violations, " violation(s)");
+                }
+                */
 
-                    std::cout << (colored ? "  \033[36m#<" : "  #<") << it->first.id << ":" << it->first.l << ":" << it->first.ld << ":" << it->first.r << ":" << it->first.rd << ">" << (colored ? "\033[0m = " : " = ") << std::endl;
+                time.Stop();
+                std::cerr << time << std::endl;
 
-                    for (int i=0; i<summands.size(); ++i) {
-                        auto t = summands[i];
+                std::cerr << "Finished." << std::endl;
 
-                        if (t.IsScaled()) {
-                            auto s = t.SeparateScalefactor();
-                            s.first = s.first.Simplify();
+                return 0;
+            }
+        private:
+            /**
+                Prints a coefficient whose calculation was aborted
+             */
+            std::string FormatAborted(const Construction::Equations::Coefficients::Definition& key) const {
+                std::stringstream ss;
 
-                            std::cout << (colored ? "     \033[32m" : "     ");
+                ss << (colored ? "  \033[36m#<" : "  #<") << key.id << ":" << key.l << ":" << key.ld << ":" << key.r << ":" << key.rd << ">" << (colored ? "\033[0m" : "") << " : " << std::endl;
+                ss << "     " << (colored ? "\033[31m" : "") << "aborted" << (colored ? "\033[0m" : "") << std::endl;
+                ss << std::endl;
 
-                            if (s.first.IsAdded()) {
-                                std::cout << "(" << s.first << ")";
-                            } else {
-                                std::cout << s.first;
-                            }
+                return ss.str();
+            }
 
-                            std::cout << (colored ? "\033[0m" : "") << " * " << (colored ? "\033[33m" : "");
+            /**
+                Prints the scalars together with the base tensors of a coefficient
+             */
+            std::string FormatCoefficient(const Construction::Equations::Coefficients::Definition& key, const Construction::Tensor::Tensor& tensor) const {
+                std::stringstream ss;
 
-                            if (s.second.IsAdded()) {
-                                std::cout << "(" << s.second << ")";
-                            } else std::cout << s.second;
-                        } else if (t.IsScalar()) {
-                            std::cout << "     " << (colored ? "\033[32m" : "") << t.ToString();
-                        } else {
-                            std::cout << "     " << (colored ? "\033[33m" : "") << t.ToString();
-                        }
+                auto summands = tensor.GetSummands();
 
-                        if (colored) std::cout << "\033[0m";
+                ss << (colored ? "  \033[36m#<" : "  #<") << key.id << ":" << key.l << ":" << key.ld << ":" << key.r << ":" << key.rd << ">" << (colored ? "\033[0m = " : " = ") << std::endl;
 
-                        if (i < summands.size()-1) std::cout << " + ";
+                for (int i=0; i<summands.size(); ++i) {
+                    auto t = summands[i];
 
-                        std::cout << std::endl;
-                    }
+                    if (t.IsScaled()) {
+                        auto s = t.SeparateScalefactor();
+                        s.first = s.first.Simplify();
 
-                    std::cout << std::endl;
-                }
-                } else {
-    int coeffPos = 1;
-    for (auto it = Construction::Equations::Coefficients::Instance()->begin(); it != Construction::Equations::Coefficients::Instance()->end(); ++it) {
-        //auto tensor = it->second->Get()->RedefineVariables("e", offset);
-        //auto tensor = substitution(*it->second->GetAsync()).CollectByVariables();
-        auto tensor = substitution(*it->second->GetAsync()).Simplify();
+                        ss << (colored ? "     \033[32m" : "     ");
 
-        auto summands = tensor.GetSummands();
+                        if (s.first.IsAdded()) {
+                            ss << "(" << s.first << ")";
+                        } else {
+                            ss << s.first;
+                        }
 
-        if (!tensor.IsZeroTensor()) {
-            offset += summands.size();
-        }
+                        ss << (colored ? "\033[0m" : "") << " * " << (colored ? "\033[33m" : "");
 
-        std::cout << "  " << (colored ? "\033[36m" : "") << "#<" << it->first.id << ":" << it->first.l << ":" << it->first.ld << ":" << it->first.r << ":" << it->first.rd << ">" << (colored ? "\033[0m" : "") << " : " << std::endl;
+                        if (s.second.IsAdded()) {
+                            ss << "(" << s.second << ")";
+                        } else ss << s.second;
+                    } else if (t.IsScalar()) {
+                        ss << "     " << (colored ? "\033[32m" : "") << t.ToString();
+                    } else {
+                        ss << "     " << (colored ? "\033[33m" : "") << t.ToString();
+                    }
 
-        for (int i=0; i<summands.size(); ++i) {
-            auto t = summands[i];
+                    if (colored) ss << "\033[0m";
 
-            if (t.IsScaled()) {
-                auto s = t.SeparateScalefactor();
-                auto abc = Construction::Tensor::Scalar(s.second.GetSummands().size(), 1) * s.first;
+                    if (i < summands.size()-1) ss << " + ";
 
-                std::cout << "     " << (colored ? "\033[32m" : "");
+                    ss << std::endl;
+                }
 
-                char c = 'a' + static_cast<char>(i);
+                ss << std::endl;
 
-                std::cout << c << coeffPos << " = " << abc.ToString();
-            } else if (t.IsScalar()) {
-                std::cout << "     " << (colored ? "\033[32m" : "") << t.ToString();
-            } else {
-                std::cout << "     " << (colored ? "\033[33m" : "") << t.ToString();
+                return ss.str();
             }
 
-            if (colored) std::cout << "\033[0m";
+            /**
+                Prints only the scalars of a coefficient, multiplied by the number
+                of terms in the base tensor they belong to
+             */
+            std::string FormatCoefficientABC(const Construction::Equations::Coefficients::Definition& key, const Construction::Tensor::Tensor& tensor, int coeffPos) const {
+                std::stringstream ss;
 
-            std::cout << std::endl;
-        }
+                auto summands = tensor.GetSummands();
 
-        std::cout << std::endl;
-        coeffPos++;
-                }
+                ss << "  " << (colored ? "\033[36m" : "") << "#<" << key.id << ":" << key.l << ":" << key.ld << ":" << key.r << ":" << key.rd << ">" << (colored ? "\033[0m" : "") << " : " << std::endl;
 
-                }
+                for (int i=0; i<summands.size(); ++i) {
+                    auto t = summands[i];
 
-                // Finally check all the coefficients
-                /*
-                {
-                    Construction::Logger::Debug("Run a final test ...");
-                    int violations = 0;
-                    for (auto &eq : equations) {
-                        Construction::Tensor::Tensor result;
+                    if (t.IsScaled()) {
+                        auto s = t.SeparateScalefactor();
+                        auto abc = Construction::Tensor::Scalar(s.second.GetSummands().size(), 1) * s.first;
 
-                        // Check the equation
-                        auto correct = eq->Test(&result);
+                        ss << "     " << (colored ? "\033[32m" : "");
 
-                        if (!correct) {
-                            Construction::Logger::Error("Equation `", eq->ToLaTeX(), "` is violated.\nFound ", result);
-                            ++violations;
-                        }
+                        char c = 'a' + static_cast<char>(i);
+
+                        ss << c << coeffPos << " = " << abc.ToString();
+                    } else if (t.IsScalar()) {
+                        ss << "     " << (colored ? "\033[32m" : "") << t.ToString();
+                    } else {
+                        ss << "     " << (colored ? "\033[33m" : "") << t.ToString();
                     }
-                    Construction::Logger::Debug("Found ", violations, " violation(s)");
-                }
-                */
 
-                time.Stop();
-                std::cerr << time << std::endl;
+                    if (colored) ss << "\033[0m";
 
-                std::cerr << "Finished." << std::endl;
+                    ss << std::endl;
+                }
 
-                return 0;
+                ss << std::endl;
+
+                return ss.str();
             }
         private:
             int parallelEqns;
+            int numThreads;
+            int timeLimit;
+            int memoryLimit;
             bool abc;
             bool colored;
         };
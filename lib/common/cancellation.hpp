@@ -0,0 +1,287 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include <common/error.hpp>
+
+namespace Construction {
+    namespace Common {
+
+        class OperationCancelledException : public Exception {
+        public:
+            OperationCancelledException(const std::string& reason) : Exception("The operation was cancelled: " + reason) { }
+        };
+
+        /**
+            \class CancellationToken
+
+            \brief Cooperative cancellation of long running operations
+
+            A token is shared by all the copies and can be cancelled by hand
+            or by its budget, i.e. once the time limit is exceeded or the
+            resident memory of the process grew by more than the memory limit
+            since the token was created. The
+            operations poll the token of the current thread at reasonable
+            points, e.g. the chunk boundaries of the task pool, and throw an
+            OperationCancelledException, s.t. the calculation unwinds.
+
+            A default constructed token is never cancelled. A token with a
+            parent is also cancelled with its parent. The task pool passes the
+            token of the enqueueing thread on to its tasks, thus the parallel
+            parts of an operation share its token.
+
+            The memory is only known for the whole process, thus operations
+            that run at the same time count towards each other's budget.
+            Memory that was allocated before the token was created does not.
+
+            A shared token serves several operations that wait for the same
+            calculation. The operations join it and it is only cancelled once
+            all of them are cancelled.
+         */
+        class CancellationToken {
+        private:
+            enum Reason {
+                NONE,
+                CANCELLED,
+                TIME_LIMIT,
+                MEMORY_LIMIT
+            };
+
+            struct State {
+                std::atomic<int> reason;
+
+                std::chrono::steady_clock::time_point deadline;
+                bool hasDeadline;
+
+                size_t memoryLimit;
+                size_t memoryBaseline;
+                std::atomic<long long> nextMemoryCheck;
+
+                std::shared_ptr<State> parent;
+
+                bool shared;
+                std::mutex mutex;
+                std::vector<std::shared_ptr<State>> joined;
+            };
+
+            typedef std::chrono::steady_clock   clock;
+        public:
+            CancellationToken() = default;
+
+            /**
+                \brief Creates a new token with the given budget
+
+                \param timeLimit    The time after which the token is cancelled or zero for no limit
+                \param memoryLimit  The growth of the resident memory of the process in megabytes
+                                    above which the token is cancelled or zero for no limit
+                \param parent       The token that cancels this one as well
+             */
+            static CancellationToken Create(std::chrono::milliseconds timeLimit = std::chrono::milliseconds(0), size_t memoryLimit = 0, const CancellationToken& parent = CancellationToken()) {
+                CancellationToken token;
+                token.state = std::make_shared<State>();
+
+                token.state->reason.store(NONE);
+                token.state->hasDeadline = timeLimit.count() > 0;
+                token.state->deadline = clock::now() + timeLimit;
+                token.state->memoryLimit = memoryLimit * 1024 * 1024;
+                token.state->memoryBaseline = (memoryLimit > 0) ? ResidentMemory() : 0;
+                token.state->nextMemoryCheck.store(0);
+                token.state->parent = parent.state;
+                token.state->shared = false;
+
+                return token;
+            }
+
+            /**
+                Creates a token that is cancelled by hand or once all the
+                tokens that joined it are cancelled, see Join()
+             */
+            static CancellationToken CreateShared() {
+                auto token = Create();
+                token.state->shared = true;
+                return token;
+            }
+
+            /**
+                Creates a new token with the budget set by SetBudget(), starting now
+             */
+            static CancellationToken WithBudget(const CancellationToken& parent = CancellationToken()) {
+                return Create(std::chrono::milliseconds(TimeLimit().load()), MemoryLimit().load(), parent);
+            }
+
+            /**
+                Set the budget of every operation started by WithBudget(). Zero means no limit.
+
+                \param timeLimit    The time limit of an operation
+                \param memoryLimit  The memory an operation may allocate in megabytes
+             */
+            static void SetBudget(std::chrono::milliseconds timeLimit, size_t memoryLimit) {
+                TimeLimit().store(timeLimit.count());
+                MemoryLimit().store(memoryLimit);
+            }
+
+            /**
+                Returns the token of the operation the current thread works on
+             */
+            static CancellationToken& Current() {
+                static thread_local CancellationToken token;
+                return token;
+            }
+        public:
+            void Cancel() {
+                if (!state) return;
+
+                int expected = NONE;
+                state->reason.compare_exchange_strong(expected, CANCELLED);
+            }
+
+            bool IsCancelled() const {
+                return IsCancelled(state);
+            }
+
+            /**
+                Let the operation of the given token wait for a shared token.
+                A default token keeps the shared token alive forever.
+
+                \returns   False if the shared token was already cancelled
+             */
+            bool Join(const CancellationToken& token) {
+                if (!state || !state->shared) return !IsCancelled();
+
+                std::unique_lock<std::mutex> lock(state->mutex);
+                if (IsJoinedCancelled(*state)) return false;
+
+                state->joined.push_back(token.state);
+                return true;
+            }
+
+            /**
+                Throws an OperationCancelledException if the token was cancelled
+             */
+            void ThrowIfCancelled() const {
+                if (!IsCancelled()) return;
+
+                switch (state->reason.load()) {
+                    case TIME_LIMIT: throw OperationCancelledException("time limit exceeded");
+                    case MEMORY_LIMIT: throw OperationCancelledException("memory limit exceeded");
+                    default: throw OperationCancelledException("cancelled");
+                }
+            }
+        private:
+            static bool IsCancelled(const std::shared_ptr<State>& state) {
+                if (!state) return false;
+                if (state->reason.load(std::memory_order_relaxed) != NONE) return true;
+
+                auto now = clock::now();
+
+                int expected = NONE;
+
+                if (state->hasDeadline && now >= state->deadline) {
+                    state->reason.compare_exchange_strong(expected, TIME_LIMIT);
+                    return true;
+                }
+
+                // Reading the memory usage is expensive, thus only check it from time to time
+                if (state->memoryLimit > 0) {
+                    long long time = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+                    long long next = state->nextMemoryCheck.load(std::memory_order_relaxed);
+
+                    if (time >= next && state->nextMemoryCheck.compare_exchange_strong(next, time + 10)) {
+                        if (ResidentMemory() > state->memoryBaseline + state->memoryLimit) {
+                            state->reason.compare_exchange_strong(expected, MEMORY_LIMIT);
+                            return true;
+                        }
+                    }
+                }
+
+                if (IsCancelled(state->parent)) {
+                    state->reason.compare_exchange_strong(expected, state->parent->reason.load());
+                    return true;
+                }
+
+                if (state->shared) {
+                    std::unique_lock<std::mutex> lock(state->mutex);
+                    return IsJoinedCancelled(*state);
+                }
+
+                return false;
+            }
+
+            /**
+                Checks if all the joined tokens of a shared token are cancelled.
+                The mutex of the state has to be held.
+             */
+            static bool IsJoinedCancelled(State& state) {
+                if (state.reason.load() != NONE) return true;
+                if (state.joined.empty()) return false;
+
+                for (auto& joined : state.joined) {
+                    if (!IsCancelled(joined)) return false;
+                }
+
+                int expected = NONE;
+                state.reason.compare_exchange_strong(expected, CANCELLED);
+                return true;
+            }
+
+            /**
+                Returns the resident memory of the process in bytes, if known, otherwise zero
+             */
+            static size_t ResidentMemory() {
+#ifdef __linux__
+                std::ifstream file ("/proc/self/statm");
+
+                size_t pages, resident;
+                if (file >> pages >> resident) {
+                    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+                }
+#endif
+                return 0;
+            }
+
+            static std::atomic<long long>& TimeLimit() {
+                static std::atomic<long long> limit (0);
+                return limit;
+            }
+
+            static std::atomic<size_t>& MemoryLimit() {
+                static std::atomic<size_t> limit (0);
+                return limit;
+            }
+        private:
+            std::shared_ptr<State> state;
+        };
+
+        /**
+            \class CancellationScope
+
+            \brief Makes a token the one of the current thread while the scope lives
+         */
+        class CancellationScope {
+        public:
+            CancellationScope(const CancellationToken& token) : previous(CancellationToken::Current()) {
+                CancellationToken::Current() = token;
+            }
+
+            ~CancellationScope() {
+                CancellationToken::Current() = std::move(previous);
+            }
+
+            CancellationScope(const CancellationScope&) = delete;
+            CancellationScope& operator=(const CancellationScope&) = delete;
+        private:
+            CancellationToken previous;
+        };
+
+    }
+}
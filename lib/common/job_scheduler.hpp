@@ -0,0 +1,176 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <common/singleton.hpp>
+#include <common/task_pool.hpp>
+
+namespace Construction {
+    namespace Common {
+
+        /**
+            \class JobScheduler
+
+            \brief Fixed number of threads that execute long running jobs by priority
+
+            Executes coarse jobs, like the calculation of a coefficient or the
+            solution of an equation, on a fixed number of threads. In contrast
+            to the tasks of a TaskPool, jobs may block, e.g. while waiting for
+            another calculation, which is why they do not run on the workers.
+            The fine grained work of the jobs is still done by the task pool.
+
+            Pending jobs with a higher priority are started first, jobs with
+            the same priority in the order they were submitted.
+         */
+        class JobScheduler {
+        private:
+            struct Job {
+                int priority;
+                unsigned long long sequence;
+                std::function<void()> function;
+
+                bool operator<(const Job& other) const {
+                    if (priority != other.priority) return priority < other.priority;
+                    return sequence > other.sequence;
+                }
+            };
+        public:
+            JobScheduler(int threads = std::thread::hardware_concurrency()) : terminate(false), sequence(0) {
+                if (threads < 1) threads = 1;
+
+                for (int i=0; i<threads; ++i) {
+                    workers.emplace_back([this] {
+                        while (true) {
+                            std::function<void()> function;
+
+                            {
+                                std::unique_lock<std::mutex> lock(mutex);
+
+                                condition.wait(lock, [this] {
+                                    return terminate || !jobs.empty();
+                                });
+
+                                if (jobs.empty()) return;
+
+                                function = jobs.top().function;
+                                jobs.pop();
+                            }
+
+                            function();
+                        }
+                    });
+                }
+            }
+
+            JobScheduler(const JobScheduler&) = delete;
+            JobScheduler& operator=(const JobScheduler&) = delete;
+
+            /**
+                Finishes all the pending jobs and joins the threads
+             */
+            ~JobScheduler() {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    terminate = true;
+                }
+
+                condition.notify_all();
+
+                for (auto& worker : workers) {
+                    worker.join();
+                }
+            }
+        public:
+            /**
+                \brief Submits a job
+
+                \param fn           The job
+                \param priority     Jobs with higher priority are started first
+                \returns            Future that is ready once the job is finished.
+                                    It carries the exception thrown by the job, if any.
+             */
+            template<typename F>
+            std::future<void> Submit(F&& fn, int priority = 0) {
+                auto job = std::make_shared<std::packaged_task<void()>>(std::forward<F>(fn));
+                auto result = job->get_future();
+
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+
+                    if (terminate) throw std::runtime_error("submit on stopped JobScheduler");
+
+                    jobs.push({ priority, sequence++, [job]() { (*job)(); } });
+                }
+
+                condition.notify_one();
+
+                return result;
+            }
+
+            /**
+                \brief Number of threads
+             */
+            unsigned Size() const {
+                return workers.size();
+            }
+        private:
+            std::vector<std::thread> workers;
+            std::priority_queue<Job> jobs;
+
+            std::mutex mutex;
+            std::condition_variable condition;
+
+            bool terminate;
+            unsigned long long sequence;
+        };
+
+    }
+
+    namespace Parallel {
+
+        /**
+            \class GlobalJobScheduler
+
+            \brief The job scheduler shared by the whole program
+
+            Runs the coefficients and equations. It has as many threads as the
+            global task pool has workers, s.t. both are sized by the same
+            setting, see GlobalTaskPool::SetNumberOfThreads(). With N workers
+            at most 2N threads calculate at the same time, i.e. N workers and
+            N jobs. Most of the time the jobs wait for the stages on the pool
+            or help it inside of their parallel loops.
+         */
+        class GlobalJobScheduler : public Singleton<GlobalJobScheduler> {
+        public:
+            GlobalJobScheduler() : scheduler(GlobalTaskPool::GetNumberOfThreads()) { }
+        public:
+            /**
+                Returns the global scheduler and creates it on the first call.
+                Thread-safe, since jobs may submit further jobs.
+             */
+            static GlobalJobScheduler* Instance() {
+                static std::once_flag flag;
+                std::call_once(flag, []() {
+                    Singleton<GlobalJobScheduler>::Instance();
+                });
+                return Singleton<GlobalJobScheduler>::Instance();
+            }
+        public:
+            template<typename F>
+            std::future<void> Submit(F&& fn, int priority = 0) {
+                return scheduler.Submit(std::forward<F>(fn), priority);
+            }
+        private:
+            Common::JobScheduler scheduler;
+        };
+
+    }
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <iostream>
 #include <iomanip>
 
@@ -37,6 +38,14 @@ namespace Construction {
                 time.Start();
             }
 
+            /**
+                Stop printing, even if not all steps were done, e.g. since
+                some calculations were aborted
+             */
+            void Stop() {
+                running = false;
+            }
+
             void Increase() {
                 if (pos < max) pos++;
             }
@@ -93,7 +102,7 @@ namespace Construction {
             TimeMeasurement time;
 
             bool started;
-            bool running;
+            std::atomic<bool> running;
         };
 
     }
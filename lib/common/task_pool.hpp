@@ -11,103 +11,99 @@
 #include <map>
 #include <future>
 #include <condition_variable>
+#include <deque>
+#include <exception>
+#include <algorithm>
 #include <functional>
 #include <stdexcept>
 
 #include <common/singleton.hpp>
 #include <common/logger.hpp>
+#include <common/cancellation.hpp>
+#include <common/work_stealing_deque.hpp>
 
 namespace Construction {
     namespace Common {
 
-        class TaskPool {
-        public:
-            TaskPool(int threads = std::thread::hardware_concurrency()) : terminate(false), stopped(false) {
-                threadPool.reserve(threads);
-
-                for (size_t i = 0; i < threads; ++i) {
-                    threadPool.emplace_back([this] {
-                        while (true) {
-                            std::function<void()> task;
+        /**
+            \class TaskPool
 
-                            std::thread::id id;
+            \brief Work-stealing pool of worker threads
 
-                            // Scope based locking
-                            {
-                                std::unique_lock<std::mutex> lock(this->tasksMutex);
+            Every worker has its own deque of tasks, see `WorkStealingDeque`.
+            Tasks enqueued by a worker go to the bottom of its own deque and
+            are also taken from there, tasks from other threads go to a shared
+            queue. Idle workers steal from the top of the other deques and are
+            only woken up if there are sleeping workers when a task is enqueued.
 
-                                // Wait until queue is not empty or termination signal is sent
-                                this->condition.wait(lock, [this] {
-                                    return this->terminate || !this->tasks.empty();
-                                });
+            Wait() blocks until all the tasks the calling thread enqueued are
+            finished. In the meantime it executes pending tasks itself, s.t.
+            tasks that wait for their own subtasks do not block the pool. Thus
+            the tasks enqueued by a task are counted for this task only and not
+            for the thread that executes it.
 
-                                if (this->terminate && this->tasks.empty()) return;
-
-                                id = this->tasks.front().first;
-
-                                // Move the top task to our reference and remove it from the queue
-                                task = std::move(this->tasks.front().second);
-                                this->tasks.erase(this->tasks.begin());
-                            }
+            Every task runs with the cancellation token of the thread that
+            enqueued it, see `CancellationToken`.
+         */
+        class TaskPool {
+        private:
+            struct Task {
+                std::function<void()> function;
+                std::shared_ptr<std::atomic<unsigned>> remaining;
+                CancellationToken token;
+            };
 
+            /**
+                The tasks enqueued by the task that is currently executed
+             */
+            struct Scope {
+                unsigned long long pool;
+                std::shared_ptr<std::atomic<unsigned>> remaining;
+            };
 
-                            // Execute task
-                            task();
+            /**
+                The pool and the index of the worker the current thread is, if any
+             */
+            struct WorkerContext {
+                unsigned long long pool;
+                int index;
+            };
+        public:
+            TaskPool(int threads = std::thread::hardware_concurrency()) : id(NextId()), terminate(false), stopped(false), sleeping(0), numInjected(0) {
+                if (threads < 1) threads = 1;
 
-                            {
-                                std::unique_lock<std::mutex> lock(tasksMutex);
+                for (int i = 0; i < threads; ++i) {
+                    deques.emplace_back(new WorkStealingDeque<Task>());
+                }
 
-                                // Decrease the number of remaining tasks
-                                std::atomic_fetch_sub_explicit(this->remainingTasks[id].get(), static_cast<unsigned>(1), std::memory_order_relaxed);
-			    }
+                threadPool.reserve(threads);
 
-                            // Notify that a task was finished
-                            this->condition_finished.notify_all();
-                        }
-                    });
-                }
+                for (int i = 0; i < threads; ++i) {
+                    threadPool.emplace_back([this, i] {
+                        CurrentWorker() = { id, i };
 
-                // Start the observer
-                /*observer = std::thread([&]() {
-                    while (true) {
-                        // First check if there is recursion in the helpers
-                        std::thread::id current_helper;
-                        if (HasRecursionInHelper(&current_helper)) {
-                            // If the worker already has an helper, wait for
-                            // it to be finished
-                            if (helper_ids[current_helper] > 3) {
+                        while (true) {
+                            if (Task* task = FindTask()) {
+                                Run(task);
                                 continue;
                             }
 
-                            // spawn a helper for the top helper
-                            SpawnHelper(current_helper, false); 
+                            std::unique_lock<std::mutex> lock(sleepMutex);
 
-                            // Add the ID to the list
-                            helper_ids[current_helper] += 1;
-                            continue;
-                        }
+                            // Announce to sleep before checking for work, s.t. enqueueing
+                            // either sees the sleeper or the check sees the task
+                            sleeping.fetch_add(1, std::memory_order_seq_cst);
 
-                        // No recursion in any helpers, check if a worker is stuck
-                        std::thread::id current;
-                        if (HasRecursion(&current)) {
-                            // If the worker already has an helper, wait for
-                            // it to be finished
-                            if (worker_ids[current] > 3) {
-                                continue;
-                            }
+                            condition.wait(lock, [this] {
+                                return terminate || HasTasks();
+                            });
 
-                            // Spawn a helper for this
-                            SpawnHelper(current, true); 
+                            sleeping.fetch_sub(1, std::memory_order_seq_cst);
 
-                            // Add the ID to the list
-                            worker_ids[current] += 1;
-                            continue;
+                            if (terminate && !HasTasks()) return;
                         }
-
-                        // Check if the shut down signal was sent
-                        if (this->terminate && this->tasks.empty()) return;
-                    }
-                });*/
+                    });
+                }
             }
 
             TaskPool(const TaskPool&) = delete;
@@ -139,6 +135,10 @@ namespace Construction {
             -> std::future<typename std::result_of<F(Args...)>::type> {
                 using return_type = typename std::result_of<F(Args...)>::type;
 
+                // don't allow enqueueing after stopping the pool
+                if (terminate || stopped)
+                    throw std::runtime_error("enqueue on stopped TaskPool");
+
                 // Make a shared_ptr to the task, where the arguments are already forwarded, and the result
                 // is given by a std::future
                 auto task = std::make_shared<std::packaged_task<return_type()> >(
@@ -148,94 +148,159 @@ namespace Construction {
                 // Obtain future to the result
                 std::future<return_type> res = task->get_future();
 
-                // Scope based locking
-                {
-                    std::unique_lock<std::mutex> lock(tasksMutex);
+                // Increase the number of active tasks of this thread
+                auto remaining = GetRemainingTasks(true);
+                remaining->fetch_add(1, std::memory_order_relaxed);
 
-                    // don't allow enqueueing after stopping the pool
-                    if (terminate || stopped)
-                        throw std::runtime_error("enqueue on stopped TaskPool");
+                Push(new Task { [task]() { (*task)(); }, remaining, CancellationToken::Current() });
 
-                    // Put task in the queue
-                    std::pair< std::thread::id, std::function<void()> > obj = { std::this_thread::get_id() , [task]() {
-                        (*task)();
-                    } };
+                return res;
+            }
 
-                    tasks.emplace_back(obj);
+            bool Empty() {
+                return !HasTasks();
+            }
 
-                    // If the thread has no tasks so far, add to the list
-                    if (this->remainingTasks.find(std::this_thread::get_id()) == this->remainingTasks.end()) {
-			this->remainingTasks.insert({ std::this_thread::get_id(), std::make_shared<std::atomic<unsigned>>(0) });
+            /**
+                \brief Number of worker threads
+             */
+            unsigned Size() const {
+                return threadPool.size();
+            }
+
+            /**
+                \brief Calls fn(i) for every i in [begin, end) in parallel
+
+                The range is split into chunks of `grain` consecutive indices
+                which are executed as one task each, by default about four chunks
+                per worker. The first chunk is executed by the calling thread.
+                Returns when all the chunks are finished. If one of the calls
+                throws, the first exception is rethrown afterwards and the chunks
+                that did not start yet are skipped. Every chunk polls the current
+                cancellation token before it starts.
+
+                \param begin    The first index
+                \param end      One past the last index
+                \param fn       The function to call on every index
+                \param grain    The number of indices per task or zero
+             */
+            template<typename F>
+            void ParallelFor(size_t begin, size_t end, F fn, size_t grain = 0) {
+                if (begin >= end) return;
+                if (grain == 0) grain = DefaultGrain(end - begin);
+
+                std::exception_ptr error;
+                std::mutex errorMutex;
+                std::atomic<bool> failed (false);
+
+                auto chunk = [&fn, &error, &errorMutex, &failed](size_t first, size_t last) {
+                    if (failed.load(std::memory_order_relaxed)) return;
+
+                    try {
+                        CancellationToken::Current().ThrowIfCancelled();
+
+                        for (size_t i=first; i<last; ++i) {
+                            fn(i);
+                        }
+                    } catch (...) {
+                        std::unique_lock<std::mutex> lock(errorMutex);
+                        if (!error) error = std::current_exception();
+                        failed.store(true, std::memory_order_relaxed);
                     }
+                };
+
+                size_t firstEnd = std::min(begin + grain, end);
+
+                // Enqueue all the other chunks
+                if (firstEnd < end) {
+                    auto remaining = GetRemainingTasks(true);
 
-                    // Increase the number of active tasks;
-                    std::atomic_fetch_add_explicit(this->remainingTasks[std::this_thread::get_id()].get(), static_cast<unsigned>(1), std::memory_order_relaxed);
- 
+                    for (size_t first = firstEnd; first < end; first += grain) {
+                        size_t last = std::min(first + grain, end);
+
+                        remaining->fetch_add(1, std::memory_order_relaxed);
+                        Push(new Task { [&chunk, first, last]() { chunk(first, last); }, remaining, CancellationToken::Current() });
+                    }
                 }
 
-                // Wake up one thread and return the future
-                condition.notify_one();
-                
-                return res;
+                chunk(begin, firstEnd);
+
+                if (firstEnd < end) Wait();
+
+                if (error) std::rethrow_exception(error);
             }
 
-            bool Empty() {
-                return tasks.empty();
+            /**
+                \brief Applies fn to all the elements in parallel
+
+                The results are written into a pre-sized vector in the order of
+                the elements, thus S has to be default constructible.
+             */
+            template<typename S, typename T, typename F>
+            std::vector<S> ParallelMap(const std::vector<T>& elements, F fn, size_t grain = 0) {
+                std::vector<S> result (elements.size());
+
+                ParallelFor(0, elements.size(), [&](size_t i) {
+                    result[i] = fn(elements[i]);
+                }, grain);
+
+                return result;
             }
 
-            template<typename S, typename T>
-            std::vector<S> Map(std::vector<T> elements, std::function<S(const T&)> fn) {
-                std::map<unsigned, S> results;
-                std::mutex resultsMutex;
+            /**
+                \brief Reduces fn(i) for every i in [begin, end) in parallel
 
-                // Enqueue all elements
-                for (int i=0; i<elements.size(); i++) {
-                    Enqueue([&results, &fn, &resultsMutex](unsigned id, const T& value) {
-                        // Calculate the element
-                        S e = fn(value);
+                Every chunk is reduced on its own, starting from the identity, and
+                the partial results are combined in the order of the chunks. Thus
+                the result is deterministic as long as the reduction is associative.
+             */
+            template<typename S, typename F, typename R>
+            S ParallelReduce(size_t begin, size_t end, S identity, F fn, R reduce, size_t grain = 0) {
+                if (begin >= end) return identity;
+                if (grain == 0) grain = DefaultGrain(end - begin);
 
-                        // Lock the mutex
-                        std::unique_lock<std::mutex> lock(resultsMutex);
+                size_t numChunks = (end - begin + grain - 1) / grain;
+                std::vector<S> partial (numChunks, identity);
 
-                        results.insert({ id, std::move(e) });
-                    }, i, elements[i]);
-                }
+                ParallelFor(0, numChunks, [&](size_t chunk) {
+                    size_t first = begin + chunk * grain;
+                    size_t last = std::min(first + grain, end);
 
-                // Wait for all tasks to finish
-                Wait();
+                    S value = identity;
+                    for (size_t i=first; i<last; ++i) {
+                        value = reduce(std::move(value), fn(i));
+                    }
 
-                std::vector<S> result;
-                for (auto& pair : results) {
-                    result.push_back(std::move(pair.second));
+                    partial[chunk] = std::move(value);
+                }, 1);
+
+                S result = std::move(identity);
+                for (auto& value : partial) {
+                    result = reduce(std::move(result), std::move(value));
                 }
 
                 return result;
             }
 
             template<typename S, typename T>
-            std::vector<S> MapEmit(std::vector<T> elements, std::function<void(const T&, std::function<void(S&&)>)> fn) {
-                std::map<unsigned, S> results;
-                std::mutex resultsMutex;
-
-                // Enqueue all elements
-                for (int i=0; i<elements.size(); i++) {
-                    Enqueue([&results, &fn, &resultsMutex](unsigned id, const T& value) {
-                        // Calculate the element
-                        fn(value, [&](S&& value) {
-                            // Lock the mutex
-                            std::unique_lock<std::mutex> lock(resultsMutex);
-
-                            results.insert({ id, std::move(value) });
-                        });
-                    }, i, elements[i]);
-                }
+            std::vector<S> Map(const std::vector<T>& elements, std::function<S(const T&)> fn) {
+                return ParallelMap<S>(elements, fn, 1);
+            }
 
-                // Wait for all tasks to finish
-                Wait();
+            template<typename S, typename T>
+            std::vector<S> MapEmit(const std::vector<T>& elements, std::function<void(const T&, std::function<void(S&&)>)> fn) {
+                // Every element has its own slot, only the first emitted value is kept
+                std::vector<std::unique_ptr<S>> slots (elements.size());
+
+                ParallelFor(0, elements.size(), [&](size_t i) {
+                    fn(elements[i], [&slots, i](S&& value) {
+                        if (!slots[i]) slots[i].reset(new S(std::move(value)));
+                    });
+                }, 1);
 
                 std::vector<S> result;
-                for (auto& pair : results) {
-                    result.push_back(std::move(pair.second));
+                for (auto& slot : slots) {
+                    if (slot) result.push_back(std::move(*slot));
                 }
 
                 return result;
@@ -243,20 +308,31 @@ namespace Construction {
 
             // Wait for all tasks to finish
             void Wait() {
-                std::unique_lock<std::mutex> lock(tasksMutex);
+                auto remaining = GetRemainingTasks(false);
+                if (remaining == nullptr) return;
+
+                while (remaining->load(std::memory_order_acquire) != 0) {
+                    // Help with the pending tasks
+                    if (Task* task = FindTask()) {
+                        Run(task);
+                        continue;
+                    }
 
-                this->condition_finished.wait(lock, [this]() -> bool {
-		            auto it = this->remainingTasks.find(std::this_thread::get_id());
-		            if (it == this->remainingTasks.end()) return true;
-                    return *(it->second) == 0;
-                });
+                    // Otherwise sleep until the last task finished. Check for new
+                    // tasks from time to time, since they are not announced here.
+                    std::unique_lock<std::mutex> lock(finishedMutex);
+
+                    condition_finished.wait_for(lock, std::chrono::milliseconds(1), [remaining]() -> bool {
+                        return remaining->load(std::memory_order_acquire) == 0;
+                    });
+                }
             }
 
             void Shutdown() {
                 // Scope based locking
                 {
-                    // Put unique lock on task mutex.
-                    std::unique_lock<std::mutex> lock(tasksMutex);
+                    // Put unique lock on the sleeping workers
+                    std::unique_lock<std::mutex> lock(sleepMutex);
 
                     // Set termination flag to true.
                     terminate = true;
@@ -271,177 +347,289 @@ namespace Construction {
                 }
 
                 // Empty workers vector.
-                threadPool.empty();
+                threadPool.clear();
 
                 // Indicate that the pool has been shut down.
                 stopped = true;
             }
-        protected:
-            bool HasRecursion(std::thread::id id) const {
-                for (auto& pair : tasks) {
-                    if (pair.first == id) return true;
-                }
-                return false;
+        private:
+            /**
+                About four chunks per worker, s.t. the load is balanced but the
+                number of tasks does not grow with the size of the range
+             */
+            size_t DefaultGrain(size_t size) const {
+                size_t chunks = 4 * std::max<size_t>(1, threadPool.size());
+                return std::max<size_t>(1, (size + chunks - 1) / chunks);
+            }
+
+            static unsigned long long NextId() {
+                static std::atomic<unsigned long long> next(1);
+                return next.fetch_add(1);
+            }
+
+            static WorkerContext& CurrentWorker() {
+                static thread_local WorkerContext context = { 0, -1 };
+                return context;
+            }
+
+            static Scope*& CurrentScope() {
+                static thread_local Scope* scope = nullptr;
+                return scope;
             }
 
             /**
-                \brief Checks if one of the workers added a task
+                Returns the index of the current thread if it is a worker of this pool, otherwise -1
+             */
+            int GetWorkerIndex() const {
+                auto& context = CurrentWorker();
+                return (context.pool == id) ? context.index : -1;
+            }
 
-                Checks if one of the workers added a task. This is necessary
-                to detect recursive job spawning that potentielly freezes the
-                task pool.
+            /**
+                \brief Returns the counter of the unfinished tasks of the caller
+
+                Inside of a task of this pool this is the counter of the task,
+                otherwise the one of the current thread. The latter is cached
+                per thread, s.t. only the first lookup of a thread has to lock.
 
-                \param out      The ID to the first worker that has a pending task
+                \param create       Create the counter if there is none yet
              */
-            bool HasRecursion(std::thread::id* out = nullptr) const {
-                for (auto& thread : threadPool) {
-                    auto id = thread.get_id();
+            std::shared_ptr<std::atomic<unsigned>> GetRemainingTasks(bool create) {
+                auto scope = CurrentScope();
+                if (scope != nullptr && scope->pool == id) {
+                    if (!scope->remaining && create) scope->remaining = std::make_shared<std::atomic<unsigned>>(0);
+                    return scope->remaining;
+                }
 
-                    if (HasRecursion(id)) {
-                        if (out) (*out) = id;
-                        return true;
-                    }
+                static thread_local unsigned long long cachedPool = 0;
+                static thread_local std::shared_ptr<std::atomic<unsigned>> cachedCounter;
+
+                if (cachedPool == id) return cachedCounter;
+
+                std::unique_lock<std::mutex> lock(remainingMutex);
+
+                auto it = remainingTasks.find(std::this_thread::get_id());
+                if (it == remainingTasks.end()) {
+                    if (!create) return nullptr;
+                    it = remainingTasks.insert({ std::this_thread::get_id(), std::make_shared<std::atomic<unsigned>>(0) }).first;
                 }
 
-                return false;
+                cachedPool = id;
+                cachedCounter = it->second;
+
+                return cachedCounter;
             }
 
-            /**
-                \brief Check if there is recursion in a helper
-             */
-            bool HasRecursionInHelper(std::thread::id* out = nullptr) const {
-                if (helpers.empty()) return false;
+            void Push(Task* task) {
+                int index = GetWorkerIndex();
 
-                for (auto& helper : helpers) {
-                    if (HasRecursion(helper.get_id())) {
-                        if (out) (*out) = helper.get_id();
-                        return true;
-                    }
+                if (index >= 0) {
+                    deques[index]->Push(task);
+                } else {
+                    std::unique_lock<std::mutex> lock(injectedMutex);
+                    injected.push_back(task);
+                    numInjected.fetch_add(1, std::memory_order_seq_cst);
                 }
 
-                return false;
+                // Only wake up a worker if one is sleeping
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (sleeping.load(std::memory_order_seq_cst) > 0) {
+                    std::unique_lock<std::mutex> lock(sleepMutex);
+                    condition.notify_one();
+                }
             }
 
             /**
-                \brief Spawn a helper thread to get rid of the recursion of the given worker
-
-                Spawn a helper thread to get rid of the recursion of the given worker.
-
-                \param id       The id of the worker
+                Takes a task from the own deque, the shared queue or steals
+                from another worker, in this order.
              */
-            void SpawnHelper(std::thread::id id, bool fromWorker=true) {
-                helpers.emplace_back(std::bind([&](std::thread::id id, bool fromWorker) {
-                    while (true) {
-                        std::function<void()> task;
+            Task* FindTask() {
+                int index = GetWorkerIndex();
 
-                        Construction::Logger::Debug("Began helper loop in thread ", std::this_thread::get_id(), " for thread ", id);
+                if (index >= 0) {
+                    if (Task* task = deques[index]->Pop()) return task;
+                }
 
-                        // Choose task where the id is tasks
-                        {
-                            std::unique_lock<std::mutex> lock (tasksMutex);
+                if (numInjected.load(std::memory_order_seq_cst) > 0) {
+                    std::unique_lock<std::mutex> lock(injectedMutex);
 
-                            bool found=false;
+                    if (!injected.empty()) {
+                        Task* task = injected.front();
+                        injected.pop_front();
+                        numInjected.fetch_sub(1, std::memory_order_seq_cst);
+                        return task;
+                    }
+                }
 
-                            for (auto it = tasks.begin(); it != tasks.end(); ++it) {
-                                if (it->first == id) {
-                                    task = std::move(it->second);
-                                    found = true;
+                // Start stealing at the next worker to spread the thieves
+                unsigned start = (index >= 0) ? index + 1 : 0;
+                for (unsigned i=0; i<deques.size(); ++i) {
+                    unsigned victim = (start + i) % deques.size();
+                    if (static_cast<int>(victim) == index) continue;
 
-                                    // Delete the task from the queue
-                                    tasks.erase(it);
-                                    break;
-                                }
-                            }
+                    if (Task* task = deques[victim]->Steal()) return task;
+                }
 
-                            // No more recursion, kill the helper
-                            if (!found) {
-                                return;
-                            }
-                        }
+                return nullptr;
+            }
 
-                        Construction::Logger::Debug("Started working on task from thread ", id);
+            bool HasTasks() const {
+                if (numInjected.load(std::memory_order_seq_cst) > 0) return true;
 
-                        // Execute the task
-                        task();
+                for (auto& deque : deques) {
+                    if (!deque->Empty()) return true;
+                }
 
-                        Construction::Logger::Debug("Finished task from thread ", id);
+                return false;
+            }
 
-                        // Execute the task in the helper thread
-                        {
-                            std::unique_lock<std::mutex> lock (tasksMutex);
+            void Run(Task* task) {
+                // Count the tasks enqueued by this task separately
+                Scope scope = { id, nullptr };
 
-                            // Decrease the number of remaining tasks
-			    std::atomic_fetch_sub_explicit(this->remainingTasks[id].get(), static_cast<unsigned>(1), std::memory_order_relaxed);
+                auto previous = CurrentScope();
+                CurrentScope() = &scope;
 
-                            if (fromWorker) {
-                                worker_ids[id]--;
-                            } else helper_ids[id]--;
-                        }
+                {
+                    CancellationScope cancellation (task->token);
+                    task->function();
+                }
 
-                        // Notify all the workers for this task to be finished
-                        this->condition_finished.notify_all();
-                    }
-                }, id, fromWorker));
+                CurrentScope() = previous;
 
-                auto id_ = helpers[helpers.size()-1].get_id();
-                Construction::Logger::Debug("New helper: ", id_, " (Number of helpers: ", helpers.size(), ")");
+                auto remaining = std::move(task->remaining);
+                delete task;
+
+                // Only wake up the waiting threads if the last task of the thread is finished
+                if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    std::unique_lock<std::mutex> lock(finishedMutex);
+                    condition_finished.notify_all();
+                }
             }
         private:
+            unsigned long long id;
+
             std::vector<std::thread> threadPool;
-            std::vector<std::thread> helpers;
-            std::vector< std::pair<std::thread::id, std::function<void()>> > tasks;
+            std::vector<std::unique_ptr<WorkStealingDeque<Task>>> deques;
+
+            std::deque<Task*> injected;
+            std::mutex injectedMutex;
+
             std::map<std::thread::id, std::shared_ptr<std::atomic<unsigned>>> remainingTasks;
-            std::map<std::thread::id, unsigned> worker_ids;
-            std::map<std::thread::id, unsigned> helper_ids;
-            std::thread observer;
+            std::mutex remainingMutex;
 
-            mutable std::mutex tasksMutex;
+            std::mutex sleepMutex;
             std::condition_variable condition;
+
+            std::mutex finishedMutex;
             std::condition_variable condition_finished;
 
             std::atomic<bool> terminate;
             std::atomic<bool> stopped;
+
+            std::atomic<unsigned> sleeping;
+            std::atomic<unsigned> numInjected;
         };
 
     }
 
     namespace Parallel {
 
+        /**
+            \class GlobalTaskPool
+
+            \brief The task pool shared by the whole program
+
+            All the parallel algorithms submit their tasks to this pool instead
+            of spawning their own threads, s.t. nested calls and concurrently
+            running coefficients do not oversubscribe the machine. Since Wait()
+            executes pending tasks, waiting inside of a task never blocks a worker.
+
+            The number of workers defaults to the number of hardware threads
+            and can be changed by SetNumberOfThreads() before the first use.
+         */
         class GlobalTaskPool : public Singleton<GlobalTaskPool> {
         public:
             // Initialize the global task pool
-            GlobalTaskPool() : pool(std::thread::hardware_concurrency()) { }
+            GlobalTaskPool() : pool(GetNumberOfThreads()) { }
+        public:
+            /**
+                Returns the global pool and creates it on the first call.
+                In contrast to the other singletons this is thread-safe, since
+                the first call may come from any of the coefficient threads.
+             */
+            static GlobalTaskPool* Instance() {
+                static std::once_flag flag;
+                std::call_once(flag, []() {
+                    Singleton<GlobalTaskPool>::Instance();
+                });
+                return Singleton<GlobalTaskPool>::Instance();
+            }
+
+            /**
+                Set the number of workers. Zero means one per hardware thread.
+                This has no effect once the pool is running.
+             */
+            static void SetNumberOfThreads(unsigned threads) {
+                NumberOfThreads().store(threads);
+            }
+
+            static unsigned GetNumberOfThreads() {
+                unsigned threads = NumberOfThreads().load();
+                if (threads == 0) threads = std::thread::hardware_concurrency();
+                return (threads == 0) ? 1 : threads;
+            }
         public:
             template<class F, class... Args>
             auto Enqueue(F &&f, Args &&... args)
             -> std::future<typename std::result_of<F(Args...)>::type> {
-                return pool.Enqueue(f, args...);
+                return pool.Enqueue(std::forward<F>(f), std::forward<Args>(args)...);
+            }
+
+            template<typename F>
+            void ParallelFor(size_t begin, size_t end, F fn, size_t grain = 0) {
+                pool.ParallelFor(begin, end, std::move(fn), grain);
+            }
+
+            template<typename S, typename T, typename F>
+            std::vector<S> ParallelMap(const std::vector<T>& elements, F fn, size_t grain = 0) {
+                return pool.ParallelMap<S>(elements, std::move(fn), grain);
+            }
+
+            template<typename S, typename F, typename R>
+            S ParallelReduce(size_t begin, size_t end, S identity, F fn, R reduce, size_t grain = 0) {
+                return pool.ParallelReduce(begin, end, std::move(identity), std::move(fn), std::move(reduce), grain);
             }
 
             template<typename S, typename T>
-            std::vector<S> Map(std::vector<T> elements, std::function<S(const T&)> fn) {
+            std::vector<S> Map(const std::vector<T>& elements, std::function<S(const T&)> fn) {
                 return pool.Map(elements, fn);
             }
 
             template<typename S, typename T>
-            std::vector<S> MapEmit(std::vector<T> elements, std::function<void(const T&, std::function<void(S&&)>)> fn) {
+            std::vector<S> MapEmit(const std::vector<T>& elements, std::function<void(const T&, std::function<void(S&&)>)> fn) {
                 return pool.MapEmit(elements, fn);
             }
 
             void Wait() {
                 pool.Wait();
             }
+        private:
+            static std::atomic<unsigned>& NumberOfThreads() {
+                static std::atomic<unsigned> threads (0);
+                return threads;
+            }
         private:
             Common::TaskPool pool;
         };
 
         template<typename S, typename T>
-        inline std::vector<S> Map(std::vector<T> elements, std::function<S(const T&)> fn) {
+        inline std::vector<S> Map(const std::vector<T>& elements, std::function<S(const T&)> fn) {
             return GlobalTaskPool::Instance()->Map(elements, fn);
         }
 
         template<typename S, typename T>
-        inline std::vector<S> MapEmit(std::vector<T> elements, std::function<void(const T&, std::function<void(S&&)>)> fn) {
+        inline std::vector<S> MapEmit(const std::vector<T>& elements, std::function<void(const T&, std::function<void(S&&)>)> fn) {
             return GlobalTaskPool::Instance()->MapEmit(elements, fn);
         }
 
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace Construction {
+    namespace Common {
+
+        /**
+            \class WorkStealingDeque
+
+            \brief Chase-Lev deque of pointers
+
+            Lock-free deque where the owning thread pushes and pops at the
+            bottom, while all other threads steal from the top. The owner
+            only competes with the thieves for the last element. The buffer
+            grows on demand and the old buffers are kept until the deque is
+            destroyed, since thieves may still read from them.
+
+            See Lê et al., "Correct and Efficient Work-Stealing for Weak
+            Memory Models" for the memory orderings.
+         */
+        template<typename T>
+        class WorkStealingDeque {
+        private:
+            class Array {
+            public:
+                explicit Array(long long size) : size(size), buffer(new std::atomic<T*>[size]) { }
+            public:
+                long long Size() const { return size; }
+
+                T* Get(long long i) const {
+                    return buffer[i & (size-1)].load(std::memory_order_relaxed);
+                }
+
+                void Put(long long i, T* value) {
+                    buffer[i & (size-1)].store(value, std::memory_order_relaxed);
+                }
+
+                Array* Grow(long long bottom, long long top) const {
+                    Array* result = new Array(2*size);
+                    for (long long i=top; i<bottom; ++i) {
+                        result->Put(i, Get(i));
+                    }
+                    return result;
+                }
+            private:
+                long long size;
+                std::unique_ptr<std::atomic<T*>[]> buffer;
+            };
+        public:
+            explicit WorkStealingDeque(long long size = 64) : top(0), bottom(0) {
+                arrays.emplace_back(new Array(size));
+                array.store(arrays.back().get(), std::memory_order_relaxed);
+            }
+
+            WorkStealingDeque(const WorkStealingDeque&) = delete;
+            WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+        public:
+            /**
+                Pushes an element to the bottom. Only called by the owner.
+             */
+            void Push(T* value) {
+                long long b = bottom.load(std::memory_order_relaxed);
+                long long t = top.load(std::memory_order_acquire);
+                Array* a = array.load(std::memory_order_relaxed);
+
+                if (b - t > a->Size() - 1) {
+                    a = a->Grow(b, t);
+                    arrays.emplace_back(a);
+                    array.store(a, std::memory_order_release);
+                }
+
+                a->Put(b, value);
+                std::atomic_thread_fence(std::memory_order_release);
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+
+            /**
+                Pops an element from the bottom. Only called by the owner.
+
+                \returns    The element or nullptr if the deque is empty
+             */
+            T* Pop() {
+                long long b = bottom.load(std::memory_order_relaxed) - 1;
+                Array* a = array.load(std::memory_order_relaxed);
+                bottom.store(b, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                long long t = top.load(std::memory_order_relaxed);
+
+                if (t > b) {
+                    bottom.store(b + 1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+
+                T* value = a->Get(b);
+
+                // Last element, race against the thieves
+                if (t == b) {
+                    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                        value = nullptr;
+                    }
+                    bottom.store(b + 1, std::memory_order_relaxed);
+                }
+
+                return value;
+            }
+
+            /**
+                Steals an element from the top. May be called by any thread.
+
+                \returns    The element or nullptr if the deque is empty or
+                            another thread was faster
+             */
+            T* Steal() {
+                long long t = top.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                long long b = bottom.load(std::memory_order_acquire);
+
+                if (t >= b) return nullptr;
+
+                Array* a = array.load(std::memory_order_acquire);
+                T* value = a->Get(t);
+
+                if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    return nullptr;
+                }
+
+                return value;
+            }
+
+            bool Empty() const {
+                long long b = bottom.load(std::memory_order_seq_cst);
+                long long t = top.load(std::memory_order_seq_cst);
+                return b <= t;
+            }
+        private:
+            std::atomic<long long> top;
+            std::atomic<long long> bottom;
+            std::atomic<Array*> array;
+
+            // All the buffers, only touched by the owner
+            std::vector<std::unique_ptr<Array>> arrays;
+        };
+
+    }
+}
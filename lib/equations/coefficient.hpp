@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <unordered_map>
 #include <mutex>
 #include <thread>
@@ -8,11 +9,14 @@
 #include <memory>
 
 #include <common/uuid.hpp>
+#include <common/cancellation.hpp>
+#include <common/job_scheduler.hpp>
 #include <language/session.hpp>
 #include <tensor/index.hpp>
 #include <tensor/tensor.hpp>
 #include <tensor/expression_database.hpp>
 #include <language/api.hpp>
+#include <equations/coefficient_stages.hpp>
 
 using Construction::Common::Unique;
 using Construction::Language::Session;
@@ -27,7 +31,7 @@ namespace Construction {
 
             Container class that handles the calculation of a specific
             coefficient in a set of equations. It is calculated in the
-            background once Start is called.
+            background by the global job scheduler once Start is called.
 
             Once the calculation is finished, the state changes and one
             can access the tensor via Get(). A call of Get() before the
@@ -47,15 +51,16 @@ namespace Construction {
         public:
             // Constructor
             Coefficient(unsigned l, unsigned ld, unsigned r, unsigned rd, const std::string& id, bool exchangeSymmetry=true)
-                : l(l), ld(ld), r(r), rd(rd), id(id), exchangeSymmetry(exchangeSymmetry), state(DEFERRED)
+                : l(l), ld(ld), r(r), rd(rd), id(id), exchangeSymmetry(exchangeSymmetry), state(DEFERRED),
+                  cancellation(Common::CancellationToken::Create())
             {
                 // Generate random name
                 name = id + GetRandomString(4);
             }
 
             virtual ~Coefficient() {
-                // Join the thread
-                thread.join();
+                // Wait for the job
+                if (job.valid()) job.wait();
             }
         public:
             // Is the coefficient calculation deferred, i.e. not started yet?
@@ -69,6 +74,12 @@ namespace Construction {
 
             // Is the coefficient calculation aborted due to an error?
             bool IsAborted() const { return state == ABORTED; }
+        public:
+            /**
+                The number of notifications of a successful calculation, i.e.
+                one per stage and one once it is finished
+             */
+            static unsigned GetNumberOfSteps() { return 3; }
         public:
             // Return a pointer to the coefficient
             std::shared_ptr<Coefficient> GetReference() {
@@ -103,11 +114,28 @@ namespace Construction {
             }
         public:
             /**
-                Start the calculation of the coefficient in a new thread
+                Submit the calculation of the coefficient to the global job
+                scheduler. Coefficients that more equations wait for are
+                started first.
              */
             void Start() {
-                // Start calculation in thread
-                thread = std::thread(&Coefficient::Calculate, this);
+                // Already calculating from now on, s.t. Wait() blocks
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    state = CALCULATING;
+                }
+
+                job = Parallel::GlobalJobScheduler::Instance()->Submit([this]() {
+                    Calculate();
+                }, observers.size());
+            }
+
+            /**
+                Cancel the calculation. It stops at the next point that polls
+                the cancellation token and the coefficient is aborted.
+             */
+            void Cancel() {
+                cancellation.Cancel();
             }
 
             /**
@@ -150,7 +178,21 @@ namespace Construction {
             }
 
             inline void SetTensor(Tensor::Tensor tensor) {
-                this->tensor = std::make_shared<Tensor::Tensor>(tensor);
+                auto vars = CollectVariables(tensor);
+
+                this->tensor = std::make_shared<Tensor::Tensor>(std::move(tensor));
+
+                std::unique_lock<std::mutex> lock(variablesMutex);
+                variables = std::move(vars);
+            }
+
+            /**
+                Returns the variables of the calculated tensor, i.e. the ones
+                that substitutions of equations with this coefficient act on
+             */
+            std::vector<Tensor::Scalar> GetVariables() const {
+                std::unique_lock<std::mutex> lock(variablesMutex);
+                return variables;
             }
 
             void Lock() {
@@ -172,17 +214,29 @@ namespace Construction {
 
                 Calculates the actual tensor with the correct symmetries. It
                 shall not be used outside of the Start method, since this will
-                generate the thread in the correct fashion and garantuees the
+                submit the job in the correct fashion and garantuees the
                 deferred calculation to work.
 
                 In between steps, the tensor will be stored on disk s.t. a
                 new start of the program does not require us to calculate this
                 coefficient again.
+
+                The steps are stages of the CoefficientStages graph, s.t.
+                coefficients of the same shape calculate them only once. Only
+                the renaming of the variables is done per coefficient.
+
+                The calculation runs with a token of the budget set in the
+                CancellationToken, which joins the tokens of the stages it
+                waits for. If it is exceeded or the coefficient is cancelled,
+                the coefficient stops waiting and is aborted, while the stages
+                go on as long as another coefficient waits for them.
              */
             void Calculate() {
                 // Lock the mutex
                 std::unique_lock<std::mutex> lock(mutex);
 
+                Common::CancellationScope scope (Common::CancellationToken::WithBudget(cancellation));
+
                 try {
                     // Set the state to calculating
                     state = CALCULATING;
@@ -193,16 +247,9 @@ namespace Construction {
                             Construction::Tensor::Scalar(GetRandomString() + "_1") * Construction::Tensor::Tensor::One()
                         );
 
-                        Notify(); // Arbitrary
-                        Notify(); // Symmetrize 1
-                        Notify(); // Symmetrize 2
-                        Notify(); // Symmetrize 3
-                        Notify(); // Symmetrize 4
-                        Notify(); // Exchange Symmetrize
+                        Notify(); // Generate
                         Notify(); // Simplify
                     } else {
-                        auto db = Construction::Tensor::ExpressionDatabase::Instance();
-
                         // Get index blocks
                         auto block1 = Construction::Tensor::Indices::GetRomanSeries(l, {1,3});
                         auto block2 = Construction::Tensor::Indices::GetRomanSeries(ld, {1,3}, l);
@@ -218,125 +265,135 @@ namespace Construction {
                         // Generate current string
                         std::string currentCmd = "Arbitrary(" + indices.ToCommand() + ")";
 
-                        // Generate the tensors
-                        if (!db->Contains(currentCmd)) {
-                            tensor = std::make_shared<Construction::Tensor::Tensor>(Construction::Language::API::Arbitrary(indices));
+                        // Build the command of the symmetrized tensor. The database key is
+                        // still the chain of the single steps, since the result spans the
+                        // same space of tensors.
+                        for (auto& block : { block1, block2, block3, block4 }) {
+                            if (block.Size() > 1) {
+                                currentCmd = "Symmetrize(" + currentCmd + ", " + block.ToCommand() + ")";
+                            }
+                        }
 
-                            // Insert into the database
-                            db->Insert(currentCmd, *tensor);
-                        } else {
-                            Construction::Logger::Debug("Found coefficient in database");
+                        if (l == r && ld == rd && exchangeSymmetry) {
+                            auto left = block1;
+                            left.Append(block2);
+
+                            auto right = block3;
+                            right.Append(block4);
 
-                            auto expr = db->Get(currentCmd).As<Construction::Tensor::Tensor>();
-                            Construction::Logger::Debug("Found ", expr);
+                            auto exchanged = right;
+                            exchanged.Append(left);
 
-                            // Copy from database
-                            tensor = std::make_shared<Construction::Tensor::Tensor>(expr);
+                            currentCmd = "ExchangeSymmetrize(" + currentCmd + ", " + indices.ToCommand() + ", " + exchanged.ToCommand() +")";
                         }
 
-                        Notify();
+                        auto stages = CoefficientStages::Instance();
 
-                        // Update the session of the coefficient
-                        //session.SetCurrent(currentCmd, *tensor);
+                        // The stages are shared by all coefficients of this shape,
+                        // thus they only capture copies of the shape
+                        auto l = this->l, ld = this->ld, r = this->r, rd = this->rd;
+                        auto exchangeSymmetry = this->exchangeSymmetry;
 
-                        // Symmetrize first block if necessary
-                        if (block1.Size() > 1) {
-                            currentCmd = "Symmetrize(" + currentCmd + ", " + block1.ToCommand() + ")";
+                        // Generate only the representatives of the orbits under the symmetries,
+                        // already symmetrized
 
-                            if (!db->Contains(currentCmd)) {
-                                tensor = std::make_shared<Construction::Tensor::Tensor>(tensor->Symmetrize(block1));
-                                db->Insert(currentCmd, *tensor);
-                            } else {
-                                tensor = std::make_shared<Construction::Tensor::Tensor>(db->Get(currentCmd).As<Construction::Tensor::Tensor>());
-                            }
+                        auto generated = stages->Stage(currentCmd, [=]() {
+                            auto db = Construction::Tensor::ExpressionDatabase::Instance();
 
-                            //session.SetCurrent(currentCmd, *tensor);
-                        }
+                            if (db->Contains(currentCmd)) {
+                                Construction::Logger::Debug("Found coefficient in database");
 
-                        Notify();
+                                // Copy from database
+                                return db->Get(currentCmd).As<Construction::Tensor::Tensor>();
+                            }
 
-                        // Symmetrize second block if necessary
-                        if (block2.Size() > 1) {
-                            currentCmd = "Symmetrize(" + currentCmd + ", " + block2.ToCommand() + ")";
+                            Construction::Generator::BaseTensorGenerator generator;
+                            auto result = generator.Generate(l, ld, r, rd, exchangeSymmetry);
 
-                            if (!db->Contains(currentCmd)) {
-                                tensor = std::make_shared<Construction::Tensor::Tensor>(tensor->Symmetrize(block2));
-                                db->Insert(currentCmd, *tensor);
-                            } else {
-                                tensor = std::make_shared<Construction::Tensor::Tensor>(db->Get(currentCmd).As<Construction::Tensor::Tensor>());
-                            }
-                        }
+                            // Insert into the database
+                            db->Insert(currentCmd, result);
 
-                        Notify();
+                            return result;
+                        });
 
-                        // Symmetrize first block if necessary
-                        if (block3.Size() > 1) {
-                            currentCmd = "Symmetrize(" + currentCmd + ", " + block3.ToCommand() + ")";
+                        tensor = std::make_shared<Construction::Tensor::Tensor>(CoefficientStages::Wait(generated));
 
-                            if (!db->Contains(currentCmd)) {
-                                tensor = std::make_shared<Construction::Tensor::Tensor>(tensor->Symmetrize(block3));
-                                db->Insert(currentCmd, *tensor);
-                            } else {
-                                tensor = std::make_shared<Construction::Tensor::Tensor>(db->Get(currentCmd).As<Construction::Tensor::Tensor>());
-                            }
-                            //session.SetCurrent(currentCmd, *tensor);
-                        }
+                        Notify(); // Generate
 
-                        Notify();
+                        // Simplify
+                        auto simplifyCmd = "LinearIndependent(" + currentCmd + ")";
 
-                        // Symmetrize first block if necessary
-                        if (block4.Size() > 1) {
-                            currentCmd = "Symmetrize(" + currentCmd + ", " + block4.ToCommand() + ")";
+                        auto simplified = stages->Stage(simplifyCmd, currentCmd, [=](const Construction::Tensor::Tensor& symmetrized) {
+                            auto db = Construction::Tensor::ExpressionDatabase::Instance();
 
-                            if (!db->Contains(currentCmd)) {
-                                tensor = std::make_shared<Construction::Tensor::Tensor>(tensor->Symmetrize(block4));
-                                db->Insert(currentCmd, *tensor);
-                            } else {
-                                tensor = std::make_shared<Construction::Tensor::Tensor>(db->Get(currentCmd).As<Construction::Tensor::Tensor>());
+                            if (db->Contains(simplifyCmd)) {
+                                return db->Get(simplifyCmd).As<Construction::Tensor::Tensor>();
                             }
 
-                            //session.SetCurrent(currentCmd, *tensor);
-                        }
+                            // The number of independent terms is known from representation theory
+                            auto rank = Construction::Generator::InvariantDimension::Compute(l, ld, r, rd, exchangeSymmetry);
+
+                            // Every summand has the symmetries of the blocks, s.t. only the
+                            // canonical components have to be compared. The positions refer
+                            // to the order of the indices of the generated tensor.
+                            auto order = symmetrized.GetIndices();
+                            auto positionsOf = [&](const Construction::Tensor::Indices& block) {
+                                std::vector<unsigned> positions;
+                                for (auto& index : block) positions.push_back(order.IndexOf(index));
+                                return positions;
+                            };
+
+                            Construction::Tensor::Symmetry symmetry;
+
+                            for (auto& block : { block1, block2, block3, block4 }) {
+                                if (block.Size() > 1) {
+                                    symmetry.Add(Construction::Tensor::ElementarySymmetry(positionsOf(block)));
+                                }
+                            }
 
-                        Notify();
+                            if (l == r && ld == rd && exchangeSymmetry) {
+                                auto left = block1;
+                                left.Append(block2);
 
-                        // Do the block exchange if necessary
-                        if (l == r && ld == rd && exchangeSymmetry) {
-                            auto exchanged = block3;
-                            exchanged.Append(block4);
-                            exchanged.Append(block1);
-                            exchanged.Append(block2);
+                                auto right = block3;
+                                right.Append(block4);
 
-                            currentCmd = "ExchangeSymmetrize(" + currentCmd + ", " + indices.ToCommand() + ", " + exchanged.ToCommand() +")";
+                                std::vector<std::vector<unsigned>> blocks = { positionsOf(left), positionsOf(right) };
+                                symmetry.Add(Construction::Tensor::ElementarySymmetry(blocks));
+                            }
 
-                            if (!db->Contains(currentCmd)) {
-                                tensor = std::make_shared<Construction::Tensor::Tensor>(tensor->ExchangeSymmetrize(indices, exchanged));
+                            auto result = symmetrized.Simplify(rank, symmetry);
 
-                                db->Insert(currentCmd, *tensor);
-                            } else {
-                                tensor = std::make_shared<Construction::Tensor::Tensor>(db->Get(currentCmd).As<Construction::Tensor::Tensor>());
-                            }
-                        }
+                            db->Insert(simplifyCmd, result);
 
-                        Notify();
-                        //session.SetCurrent(currentCmd, *tensor);
+                            return result;
+                        });
 
-                        // Simplify and redefine variables
-                        currentCmd = "LinearIndependent(" + currentCmd + ")";
-                        if (!db->Contains(currentCmd)) {
-                            tensor = std::make_shared<Construction::Tensor::Tensor>(tensor->Simplify().RedefineVariables(GetRandomString()));
+                        // Every coefficient gets its own variables
+                        tensor = std::make_shared<Construction::Tensor::Tensor>(CoefficientStages::Wait(simplified).RedefineVariables(GetRandomString()));
 
-                            db->Insert(currentCmd, *tensor);
-                        } else {
-                            tensor = std::make_shared<Construction::Tensor::Tensor>(db->Get(currentCmd).As<Construction::Tensor::Tensor>());
-                        }
+                        Notify(); // Simplify
+                    }
+
+                    {
+                        auto vars = CollectVariables(*tensor);
 
-                        Notify();
+                        std::unique_lock<std::mutex> lock(variablesMutex);
+                        variables = std::move(vars);
                     }
 
                     Session::Instance()->Set(name, std::move(*tensor));
 
                     //session.SetCurrent(currentCmd, *tensor);
+                } catch (const Common::OperationCancelledException& e) {
+                    Construction::Logger::Warning("Coefficient ", ToString(false), " aborted: ", e.what());
+
+                    state = ABORTED;
+
+                    Notify();
+                    variable.notify_all();
+
+                    return;
                 } catch(...) {
                     // In case of exception, just set the calculation to aborted
                     state = ABORTED;
@@ -357,6 +414,20 @@ namespace Construction {
                 Notify();
                 variable.notify_all();
             }
+        private:
+            static std::vector<Tensor::Scalar> CollectVariables(const Tensor::Tensor& tensor) {
+                std::vector<Tensor::Scalar> result;
+
+                for (auto& summand : tensor.GetSummands()) {
+                    for (auto& variable : summand.SeparateScalefactor().first.GetVariables()) {
+                        if (std::find(result.begin(), result.end(), variable) == result.end()) {
+                            result.push_back(std::move(variable));
+                        }
+                    }
+                }
+
+                return result;
+            }
         public:
             /**
                 Generate a random string out of alphabeticals
@@ -398,9 +469,10 @@ namespace Construction {
         private:
             mutable std::mutex mutex;
             mutable std::mutex readMutex;
+            mutable std::mutex variablesMutex;
 
             std::condition_variable variable;
-            std::thread thread;
+            std::future<void> job;
 
             //Session session;
             State state;
@@ -413,6 +485,9 @@ namespace Construction {
             bool exchangeSymmetry;
 
             std::shared_ptr<Tensor::Tensor> tensor;
+            std::vector<Tensor::Scalar> variables;
+
+            Common::CancellationToken cancellation;
         };
 
         typedef std::shared_ptr<Coefficient>   CoefficientReference;
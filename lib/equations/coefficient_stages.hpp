@@ -0,0 +1,222 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <common/cancellation.hpp>
+#include <common/task_pool.hpp>
+#include <tensor/tensor.hpp>
+
+namespace Construction {
+    namespace Equations {
+
+        /**
+            \class CoefficientStages
+
+            \brief Task graph of the stages of all coefficient calculations
+
+            The calculation of a coefficient is a chain of stages, i.e. the
+            generation of the symmetrized tensor and the extraction of the
+            linear independent terms, that only depends on the shape of the
+            coefficient but not on its id. Every stage is a node identified
+            by its command and is calculated at most once on the global task
+            pool, all the coefficients of the same shape share the result.
+
+            A stage that depends on another one is only enqueued once the other
+            stage is finished, s.t. no worker ever waits for a stage. Errors
+            are passed on to the dependent stages.
+
+            A stage runs with a shared CancellationToken that every requester
+            joins, thus it is only cancelled once all the coefficients waiting
+            for it are cancelled. A cancelled stage is removed again, s.t. the
+            next request calculates it anew.
+         */
+        class CoefficientStages {
+        public:
+            typedef std::shared_future<Tensor::Tensor>                      Result;
+            typedef std::function<Tensor::Tensor()>                         StageFunction;
+            typedef std::function<Tensor::Tensor(const Tensor::Tensor&)>    DependentStageFunction;
+        private:
+            struct Node {
+                std::promise<Tensor::Tensor> promise;
+                Result result;
+
+                Common::CancellationToken token;
+
+                bool finished = false;
+                std::vector<std::function<void()>> continuations;
+            };
+        public:
+            /**
+                Returns the stages of the program. They are never destroyed,
+                since the stages may still be running at exit.
+             */
+            static CoefficientStages* Instance() {
+                static CoefficientStages* instance = new CoefficientStages();
+                return instance;
+            }
+        public:
+            /**
+                \brief Returns the result of the stage with the given key
+
+                Only the first call for the key enqueues the calculation,
+                all the others share its result. The token of the current
+                thread joins the token of the stage.
+
+                \param key      The command of the stage
+                \param fn       The calculation of the stage
+             */
+            Result Stage(const std::string& key, StageFunction fn) {
+                std::shared_ptr<Node> node;
+
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    if (!Insert(key, node)) return node->result;
+                }
+
+                Enqueue([this, key, node, fn]() {
+                    Finish(key, node, fn);
+                });
+
+                return node->result;
+            }
+
+            /**
+                \brief Returns the result of the stage with the given key that
+                       is calculated from the result of another stage
+
+                \param key          The command of the stage
+                \param dependency   The key of the stage it depends on
+                \param fn           The calculation of the stage
+                \throws std::runtime_error if the dependency is unknown
+             */
+            Result Stage(const std::string& key, const std::string& dependency, DependentStageFunction fn) {
+                std::unique_lock<std::mutex> lock(mutex);
+
+                // Look up the dependency first, s.t. no node is left behind without a result
+                auto it = nodes.find(dependency);
+                if (it == nodes.end()) {
+                    throw std::runtime_error("Unknown stage `" + dependency + "`");
+                }
+
+                auto parent = it->second;
+
+                std::shared_ptr<Node> node;
+                if (!Insert(key, node)) return node->result;
+
+                std::function<void()> run = [this, key, node, parent, fn]() {
+                    Finish(key, node, [&]() {
+                        return fn(parent->result.get());
+                    });
+                };
+
+                if (!parent->finished) {
+                    parent->continuations.push_back(std::move(run));
+                } else {
+                    lock.unlock();
+                    Enqueue(std::move(run));
+                }
+
+                return node->result;
+            }
+
+            /**
+                \brief Waits for the result of a stage
+
+                In contrast to get() the token of the current thread is polled
+                while waiting, s.t. a cancelled coefficient does not wait for
+                a stage that is shared with others.
+
+                \throws Common::OperationCancelledException if the token of the current thread is cancelled
+             */
+            static const Tensor::Tensor& Wait(const Result& result) {
+                while (result.wait_for(std::chrono::milliseconds(10)) != std::future_status::ready) {
+                    Common::CancellationToken::Current().ThrowIfCancelled();
+                }
+
+                return result.get();
+            }
+        private:
+            CoefficientStages() = default;
+
+            /**
+                Inserts a new node for the key if there is none yet or if the
+                present one is cancelled. The mutex has to be held by the caller.
+
+                \returns    True if the node was inserted
+             */
+            bool Insert(const std::string& key, std::shared_ptr<Node>& node) {
+                auto current = Common::CancellationToken::Current();
+
+                auto it = nodes.find(key);
+                if (it != nodes.end() && (it->second->finished || it->second->token.Join(current))) {
+                    node = it->second;
+                    return false;
+                }
+
+                node = std::make_shared<Node>();
+                node->result = node->promise.get_future().share();
+                node->token = Common::CancellationToken::CreateShared();
+                node->token.Join(current);
+
+                nodes[key] = node;
+                return true;
+            }
+
+            void Enqueue(std::function<void()> fn) {
+                Parallel::GlobalTaskPool::Instance()->Enqueue(std::move(fn));
+            }
+
+            /**
+                Calculates the stage and enqueues all the stages that wait for it.
+                If the stage was cancelled, it is removed.
+             */
+            void Finish(const std::string& key, const std::shared_ptr<Node>& node, StageFunction fn) {
+                bool cancelled = false;
+
+                {
+                    Common::CancellationScope scope (node->token);
+
+                    try {
+                        node->token.ThrowIfCancelled();
+                        node->promise.set_value(fn());
+                    } catch (const Common::OperationCancelledException&) {
+                        node->promise.set_exception(std::current_exception());
+                        cancelled = true;
+                    } catch (...) {
+                        node->promise.set_exception(std::current_exception());
+                    }
+                }
+
+                std::vector<std::function<void()>> continuations;
+
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    node->finished = true;
+                    std::swap(continuations, node->continuations);
+
+                    // Only remove the node if it was not replaced in the meantime
+                    auto it = nodes.find(key);
+                    if (cancelled && it != nodes.end() && it->second == node) {
+                        nodes.erase(it);
+                    }
+                }
+
+                for (auto& continuation : continuations) {
+                    Enqueue(std::move(continuation));
+                }
+            }
+        private:
+            std::map<std::string, std::shared_ptr<Node>> nodes;
+            std::mutex mutex;
+        };
+
+    }
+}
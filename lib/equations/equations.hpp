@@ -1,8 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <limits>
+#include <list>
+#include <map>
 #include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+#include <common/cancellation.hpp>
 #include <common/singleton.hpp>
 #include <language/cli.hpp>
 #include <equations/coefficient.hpp>
@@ -19,170 +27,279 @@ namespace Construction {
             \brief Class that manages the substitution of results from equations
                    into the coefficients.
 
-            Class that manages the substitution of results from equations
             Class that manages the substitution of results from equations
             into the coefficients. This works by a ticket system, i.e. any
-            equation that can be calculated asks the manager for a ticket.
-            If there are no tickets available for now, the equation thread
-            is blocked until new tickets are available.
+            equation that can be calculated requests a ticket for its
+            coefficients. The ticket claims these and all the other calculated
+            coefficients that share variables with them, since these are the
+            ones the substitution of the equation acts on.
+
+            Equations with disjoint claims are independent and are solved at
+            the same time. An equation whose claim overlaps with another one
+            waits until that is released, s.t. the substitutions within a set
+            of connected coefficients are applied one after the other. There
+            is no global barrier.
 
             If an equation has a ticket, it can be evaluated and the resulting
-            substitution is send by the ticket back into the manager.
+            substitution is send by the ticket back into the manager. It is
+            applied in parallel to the claimed coefficients that contain one of
+            the substituted variables, the others are released unchanged. The
+            manager keeps an inverted index from the variables to coefficients
+            for this, s.t. the costs only scale with what actually changes.
          */
         class SubstitutionManager : public Singleton<SubstitutionManager> {
         public:
-            // The manager is either serving a locked
-            enum State {
-                SERVING,
-                LOCKED
-            };
-        protected:
             /**
                 \class Ticket
 
-
+                The claim of an equation on a set of coefficients
              */
-            class Ticket : public std::enable_shared_from_this<Ticket> {
-            public:
-                enum State {
-                    WAITING,
-                    FULFILLED
-                };
+            class Ticket {
             public:
+                /**
+                    Apply the substitution to the claimed coefficients and release them
+                 */
                 void Fulfill(const Substitution& substitution) {
-                    SubstitutionManager::Instance()->Fulfill(shared_from_this(), substitution);
+                    SubstitutionManager::Instance()->Fulfill(*this, &substitution);
+                }
+
+                /**
+                    Release the claimed coefficients without any substitution, e.g.
+                    if the equation could not be solved
+                 */
+                void Release() {
+                    SubstitutionManager::Instance()->Fulfill(*this, nullptr);
                 }
             public:
                 friend class SubstitutionManager;
             private:
-                State state;
+                std::vector<CoefficientReference> coefficients;
+                bool fulfilled = false;
             };
 
-            void Fulfill(std::shared_ptr<Ticket> ticket, const Substitution& substition) {
-                {
-                    // Lock the mutex
-                    std::unique_lock<std::mutex> lock(mutex);
-
-                    // Check if the ticket was already served
-                    auto it = std::find(tickets.begin(), tickets.end(), ticket);
-                    if (it == tickets.end()) return;
-
-                    // Remove the ticket from the list and mark it fulfilled
-                    tickets.erase(it);
-                    ticket->state = Ticket::FULFILLED;
+            typedef std::function<void(std::shared_ptr<Ticket>)>   StartFunction;
+        private:
+            struct Request {
+                std::vector<CoefficientReference> coefficients;
+                StartFunction start;
+            };
+        public:
+            /**
+                \brief Request a ticket for an equation
 
-                    // Insert the substitution
-                    substitutions.push_back(substition);
+                The start function is called with the ticket as soon as none of
+                the coefficients the equation acts on are claimed, which may be
+                right away. It is supposed to solve the equation in the background
+                and to fulfill the ticket. Requests are served in order, later ones
+                only overtake if their claims are disjoint.
 
-                    // Set the state to locked to keep the manager
-                    // from giving further tickets
-                    state = LOCKED;
+                \param coefficients     The coefficients in the equation
+                \param start            Starts the solution of the equation
+             */
+            void RequestTicket(const std::vector<CoefficientReference>& coefficients, StartFunction start) {
+                std::unique_lock<std::mutex> lock(mutex);
 
-                    Construction::Logger::Debug("Fulfilled ticket ", ticket);
+                // Every coefficient gets its own variables, i.e. it can only share
+                // them with others after it was part of an equation. Hence it is
+                // sufficient to index the coefficients of the equations.
+                for (auto& ref : coefficients) {
+                    if (indexed.find(ref.get()) == indexed.end()) Index(ref);
                 }
 
-                // If no ticket left, apply the substitutions
-                if (tickets.size() == 0) {
-                    Apply();
-                }
+                requests.push_back({ coefficients, std::move(start) });
+
+                ServeRequests();
             }
         public:
-            std::shared_ptr<Ticket> GetTicket() {
-                // Lock the mutex
+            /**
+                Set the maximal number of equations that are solved at the same
+                time. Zero means no limit apart from the job scheduler.
+             */
+            void SetMaxTickets(int tickets=4) {
                 std::unique_lock<std::mutex> lock(mutex);
+                maxTickets = tickets;
+            }
+        private:
+            /**
+                Adds the coefficient to the variable index or updates its entries
+                if the tensor has changed. Requires the mutex.
+             */
+            void Index(const CoefficientReference& ref) {
+                auto& entry = indexed[ref.get()];
 
-                // Wait for the thread to be ticket less
-                variable.wait(lock, [&]() {
-                    return state == SERVING;
-                });
+                for (auto& name : entry.variables) {
+                    auto it = index.find(name);
+                    if (it == index.end()) continue;
 
-                // Create ticket
-                auto ticket = std::make_shared<Ticket>();
+                    it->second.erase(ref.get());
+                    if (it->second.size() == 0) index.erase(it);
+                }
+
+                entry.ref = ref;
+                entry.variables.clear();
 
-                // Add to the list and return one for the thread
-                tickets.push_back(ticket);
+                for (auto& variable : ref->GetVariables()) {
+                    auto name = variable.ToString();
 
-                // If the number of tickets is equal to a threshold
-                // set the state to LOCKED
-                if (tickets.size() == maxTickets) {
-                    state = LOCKED;
+                    index[name].insert(ref.get());
+                    entry.variables.push_back(std::move(name));
                 }
+            }
 
-                Construction::Logger logger;
-                logger << Construction::Logger::DEBUG << "Issued ticket " << ticket << Construction::Logger::endl;
+            /**
+                Returns the coefficients together with all indexed coefficients
+                that share variables with them. Requires the mutex.
+             */
+            std::vector<CoefficientReference> GetClaim(const std::vector<CoefficientReference>& coefficients) const {
+                std::vector<CoefficientReference> result = coefficients;
 
-                return std::move(ticket);
-            }
-        public:
-            void SetMaxTickets(int tickets=4) {
-                maxTickets = tickets;
+                std::set<Coefficient*> visited;
+                for (auto& ref : coefficients) {
+                    visited.insert(ref.get());
+                }
+
+                for (auto& ref : coefficients) {
+                    auto it = indexed.find(ref.get());
+                    if (it == indexed.end()) continue;
+
+                    for (auto& name : it->second.variables) {
+                        auto jt = index.find(name);
+                        if (jt == index.end()) continue;
+
+                        for (auto& other : jt->second) {
+                            if (!visited.insert(other).second) continue;
+                            result.push_back(indexed.at(other).ref);
+                        }
+                    }
+                }
+
+                return result;
             }
-        private:
-            void Apply() {
-                // Lock the mutex
-                std::unique_lock<std::mutex> lock(mutex);
 
-                Construction::Logger::Debug("Apply substitutions (from ", substitutions.size(), " tickets)");
+            /**
+                Issues tickets for the waiting requests in their order. The claim
+                of a request that has to wait is reserved, s.t. no later request
+                can overtake it on these coefficients. Requires the mutex.
+             */
+            void ServeRequests() {
+                std::set<Coefficient*> reserved;
+
+                for (auto it = requests.begin(); it != requests.end(); ) {
+                    if (maxTickets > 0 && numTickets >= maxTickets) break;
 
-                // Merge
-                {
-                    int i=1;
-                    for (auto& subst : substitutions) {
-                        Construction::Logger::Debug("Substitution #", i, ": ", subst);
-                        ++i;
+                    auto claim = GetClaim(it->coefficients);
+
+                    bool isFree = true;
+                    for (auto& ref : claim) {
+                        if (claimed.find(ref.get()) != claimed.end() || reserved.find(ref.get()) != reserved.end()) {
+                            isFree = false;
+                            break;
+                        }
+                    }
+
+                    if (!isFree) {
+                        for (auto& ref : claim) {
+                            reserved.insert(ref.get());
+                        }
+
+                        ++it;
+                        continue;
                     }
+
+                    // Claim the coefficients
+                    for (auto& ref : claim) {
+                        claimed.insert(ref.get());
+                    }
+
+                    auto ticket = std::make_shared<Ticket>();
+                    ticket->coefficients = std::move(claim);
+                    ++numTickets;
+
+                    auto start = std::move(it->start);
+                    it = requests.erase(it);
+
+                    Construction::Logger::Debug("Issued ticket ", ticket, " for ", ticket->coefficients.size(), " coefficients");
+
+                    start(ticket);
                 }
+            }
 
-                auto merged = Tensor::Substitution::Merge(substitutions);
+            void Fulfill(Ticket& ticket, const Substitution* substitution) {
+                // Only the coefficients that contain a substituted variable change. They
+                // cannot change in the meantime since they are claimed by this ticket.
+                std::vector<CoefficientReference> affected;
+                std::vector<Tensor::Tensor> updated;
 
-                Construction::Logger::Debug("Merged substitutions into ", merged);
+                if (substitution != nullptr) {
+                    std::set<std::string> substituted;
+                    for (auto& pair : *substitution) {
+                        substituted.insert(pair.first.ToString());
+                    }
 
-                // Reset the list of substitutions
-                substitutions.clear();
+                    for (auto& ref : ticket.coefficients) {
+                        if (!ref->IsFinished()) continue;
 
-                // Lock all the coefficients
-                CoefficientsLock coeffsLock;
+                        for (auto& variable : ref->GetVariables()) {
+                            if (substituted.find(variable.ToString()) != substituted.end()) {
+                                affected.push_back(ref);
+                                break;
+                            }
+                        }
+                    }
+
+                    Construction::Logger::Debug("Apply substitution ", *substitution, " to ", affected.size(), " of ", ticket.coefficients.size(), " coefficients");
 
-                // Print all coefficients before any update
-                Construction::Logger::Debug("==================== UPDATE ALL COEFFICIENTS ======================");
-                for (auto& pair : *Coefficients::Instance()) {
-                    Construction::Logger::Debug("Coefficient before update: ", pair.second->ToString());
+                    updated = Parallel::GlobalTaskPool::Instance()->ParallelMap<Tensor::Tensor>(affected, [&](const CoefficientReference& ref) {
+                        return (*substitution)(*ref->GetAsync()).FastSimplify();
+                    }, 1);
                 }
 
-                // Iterate over all coefficients and apply the
-                for (auto& pair : *Coefficients::Instance()) {
-                    auto ref = pair.second;
+                std::unique_lock<std::mutex> lock(mutex);
 
-                    if (ref->IsFinished()) {
-                        Construction::Logger::Debug("Update coefficient ", ref->GetName());
+                // Check if the ticket was already served
+                if (ticket.fulfilled) return;
 
-                        ref->SetTensor(merged(*ref->GetAsync()).FastSimplify());
+                for (unsigned i=0; i<affected.size(); ++i) {
+                    auto& ref = affected[i];
 
-                        Construction::Logger::Debug("Updated coefficient: ", ref->ToString());
+                    ref->SetTensor(std::move(updated[i]));
+                    Index(ref);
 
-                        // Overwrite the tensor in the session
-                        Session::Instance()->Set(ref->GetName(), *ref->GetAsync());
-                    }
+                    Construction::Logger::Debug("Updated coefficient: ", ref->ToString());
+
+                    // Overwrite the tensor in the session
+                    Session::Instance()->Set(ref->GetName(), *ref->GetAsync());
                 }
 
-                Construction::Logger::Debug("==================== FINISHED UPDATE ======================");
+                // Release the coefficients
+                for (auto& ref : ticket.coefficients) {
+                    claimed.erase(ref.get());
+                }
 
-                // Set the state back to serving
-                state = SERVING;
+                ticket.fulfilled = true;
+                --numTickets;
 
-                // Wake up all sleeping threads
-                variable.notify_all();
+                Construction::Logger::Debug("Fulfilled ticket ", &ticket);
+
+                ServeRequests();
             }
         private:
-            State state;
-
             int maxTickets = 4;
+            int numTickets = 0;
 
-            std::vector<Tensor::Substitution> substitutions;
-            std::vector<std::shared_ptr<Ticket>> tickets;
+            std::list<Request> requests;
+            std::set<Coefficient*> claimed;
+
+            // Inverted index from the names of the variables to the coefficients
+            struct IndexEntry {
+                CoefficientReference ref;
+                std::vector<std::string> variables;
+            };
+
+            std::map<Coefficient*, IndexEntry> indexed;
+            std::unordered_map<std::string, std::set<Coefficient*>> index;
 
             std::mutex mutex;
-            std::condition_variable variable;
         };
 
         /**
@@ -211,7 +328,11 @@ namespace Construction {
             with the right symmetries for lambda.
 
             Once all the coefficients in the equation are calculated, the
-            equation is solved in a separate thread.
+            equation is solved by the global job scheduler. Equations are
+            started before any pending coefficient, since they unblock the
+            substitutions. If one of the coefficients is aborted, or the
+            solution is cancelled or exceeds the budget of the CancellationToken,
+            the equation is aborted without a substitution.
          */
         class Equation {
         public:
@@ -223,21 +344,20 @@ namespace Construction {
             };
         public:
             // Constructor
-            Equation(const std::string& code) : state(WAITING), code(code) {
+            Equation(const std::string& code) : state(WAITING), code(code), cancellation(Common::CancellationToken::Create()) {
                 // Parse the code
                 Parse(code);
             }
 
             ~Equation() {
-                // Join the thread of the calculation
-                if (!isEmpty) {
-                    thread.join();
-                }
+                // Wait for the job of the calculation
+                if (job.valid()) job.wait();
             }
         public:
             bool IsWaiting() const { return state == WAITING; }
             bool IsSolving() const { return state == SOLVING; }
             bool IsSolved() const { return state == SOLVED; }
+            bool IsAborted() const { return state == ABORTED; }
 
             bool IsEmpty() const { return isEmpty; }
         public:
@@ -414,6 +534,27 @@ namespace Construction {
                 Callback that is called by finished coefficients
              */
             void OnCoefficientCalculated(const CoefficientReference& coefficient) {
+                // The equation cannot be solved without the coefficient
+                if (coefficient->IsAborted()) {
+                    {
+                        std::unique_lock<std::mutex> lock(startMutex);
+                        if (state != WAITING || isRequested) return;
+                        isRequested = true;
+                    }
+
+                    Construction::Logger::Warning("Equation `", eq, "` aborted, since the coefficient ", coefficient->ToString(false), " is aborted");
+
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        state = ABORTED;
+                    }
+
+                    variable.notify_all();
+                    Notify();
+
+                    return;
+                }
+
                 // Check if all coefficients are calculated
                 for (auto& c : coefficients) {
                     // If not finished, do nothing
@@ -422,30 +563,55 @@ namespace Construction {
                     }
                 }
 
-                // Lock the mutex
-                std::unique_lock<std::mutex> lock(startMutex);
+                // Only request once, every coefficient notifies again
+                {
+                    std::unique_lock<std::mutex> lock(startMutex);
+                    if (state != WAITING || isRequested) return;
+                    isRequested = true;
+                }
 
                 Construction::Logger logger;
                 logger << Construction::Logger::DEBUG << "Finished all coefficients for equation `" << eq << "`" << Construction::Logger::endl;
 
-                if (state == WAITING) {
-                    // Solve the equation in a new thread#
-                    this->thread = std::thread(&Equation::Solve, this);
-                }
+                // Solve as soon as no other equation acts on the same coefficients
+                SubstitutionManager::Instance()->RequestTicket(coefficients, [this](std::shared_ptr<SubstitutionManager::Ticket> ticket) {
+                    std::unique_lock<std::mutex> lock(startMutex);
+
+                    job = Parallel::GlobalJobScheduler::Instance()->Submit([this, ticket]() {
+                        try {
+                            Solve(ticket);
+                        } catch (const std::exception& e) {
+                            Construction::Logger::Error("Error in equation `", eq, "`: ", e.what());
+
+                            // Do not keep the other equations waiting
+                            ticket->Release();
+
+                            // Wake up the waiting threads instead of leaving them blocked
+                            {
+                                std::unique_lock<std::mutex> lock(mutex);
+                                state = ABORTED;
+                            }
+
+                            variable.notify_all();
+                            Notify();
+                        }
+                    }, std::numeric_limits<int>::max());
+                });
             }
 
-            void Solve() {
+            void Solve(std::shared_ptr<SubstitutionManager::Ticket> ticket) {
                 std::unique_lock<std::mutex> lock(mutex);
 
+                Common::CancellationScope scope (Common::CancellationToken::WithBudget(cancellation));
+
                 // Set the state to solving
                 state = SOLVING;
 
                 Construction::Logger logger;
                 logger << Construction::Logger::DEBUG << "Start solving equation `" << eq << "`" << Construction::Logger::endl;
 
-                //   I. Get a ticket to promise to yield a substitution
-                //      or wait until a ticket can be returned
-                auto ticket = SubstitutionManager::Instance()->GetTicket();
+                //   I. The ticket promises to yield a substitution for the
+                //      claimed coefficients
 
                 //  II. Use the CLI to parse the equation and execute it
                 //      to obtain the substitution
@@ -539,6 +705,14 @@ namespace Construction {
                 // Check if the tensor is zero
                 return testResult.IsZeroTensor();
             }
+        public:
+            /**
+                Cancel the solution of the equation. It stops at the next point
+                that polls the cancellation token and the equation is aborted.
+             */
+            void Cancel() {
+                cancellation.Cancel();
+            }
         public:
             Tensor::Substitution GetSubstition() {
                 if (state != SOLVED) Wait();
@@ -549,7 +723,7 @@ namespace Construction {
                 std::unique_lock<std::mutex> lock(mutex);
 
                 variable.wait(lock, [&]() {
-                    return state == SOLVED;
+                    return state == SOLVED || state == ABORTED;
                 });
             }
 
@@ -619,12 +793,13 @@ namespace Construction {
                 return output;
             }
         private:
-            std::thread thread;
+            std::future<void> job;
             std::mutex mutex;
             std::mutex startMutex;
             std::condition_variable variable;
 
             bool isEmpty;
+            bool isRequested = false;
 
             std::string code;
             std::string eq;
@@ -638,6 +813,8 @@ namespace Construction {
             std::vector<ObserverFunction> observers;
 
             State state;
+
+            Common::CancellationToken cancellation;
         };
 
     }
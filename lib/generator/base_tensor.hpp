@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cassert>
+#include <numeric>
+#include <set>
 
 #include <common/time_measurement.hpp>
 
@@ -39,79 +41,118 @@ namespace Construction {
         class BaseTensorGenerator {
         public:
             /**
-                Generates the
+                \brief Enumerate all the gamma pairings of n index positions
+
+                Enumerate all the ways to split the positions {0, ..., n-1}
+                into pairs without recursion. The pairing is encoded by
+                the choices c_k, i.e. the lowest unused position is paired
+                with the (c_k+1)-th of the remaining ones. Incrementing the
+                choices like an odometer thus gives all the (n-1)!! pairings
+                in lexicographic order.
+
+                The callback is called with the positions of the pairs in
+                a row. The buffers are reused, so no allocations happen
+                per pairing.
              */
-            std::vector<std::pair<Indices, Indices>> GenerateTwoPartition(const Indices& indices) const {
-                assert(indices.Size() > 1);
+            template<typename F>
+            void ForEachPairing(const std::vector<unsigned>& positions, F callback) const {
+                assert(positions.size() % 2 == 0);
 
-                std::vector<std::pair<Indices, Indices>> result;
+                unsigned numPairs = positions.size() / 2;
 
-                // Take the first letter
-                auto first = indices[0];
+                std::vector<unsigned> choices (numPairs, 0);
+                std::vector<unsigned> remaining (positions.size());
+                std::vector<unsigned> result (positions.size());
 
-                for (int i=1; i<indices.Size(); i++) {
-                    auto current = indices[i];
+                while (true) {
+                    // Build the pairing from the choices
+                    remaining = positions;
+                    unsigned size = remaining.size();
 
-                    Indices remaining = indices;
+                    for (unsigned k=0; k<numPairs; k++) {
+                        unsigned choice = choices[k] + 1;
 
-                    Indices gamma;
-                    gamma.Insert(first);
-                    gamma.Insert(current);
+                        result[2*k] = remaining[0];
+                        result[2*k+1] = remaining[choice];
 
-                    remaining.Remove(i);
-                    remaining.Remove(0);
+                        // Remove the two positions and keep the order
+                        for (unsigned i=1; i<choice; i++) remaining[i-1] = remaining[i];
+                        for (unsigned i=choice+1; i<size; i++) remaining[i-2] = remaining[i];
+                        size -= 2;
+                    }
 
-                    result.push_back({ gamma, remaining });
-                }
+                    callback(result);
 
-                return result;
-            }
+                    // Advance the odometer, the last pair has no choice
+                    int k = static_cast<int>(numPairs) - 1;
+                    for (; k >= 0; k--) {
+                        if (++choices[k] < positions.size() - 2*k - 1) break;
+                        choices[k] = 0;
+                    }
 
-            std::vector<Indices> GenerateEvenRank(const Indices& indices) const {
-                auto res = GenerateTwoPartition(indices);
-                std::vector<Indices> result;
+                    if (k < 0) break;
+                }
+            }
 
-                if (indices.Size() == 2) {
+            /**
+                \brief Enumerate all the epsilon-gamma splittings of n index positions
 
-                    for (auto& pair : res) {
-                        result.push_back(pair.first);
-                    }
-                } else {
-                    for (auto& pair : res) {
-                        auto newComb = GenerateEvenRank(pair.second);
-                        for (auto &v : newComb) {
-                            auto current = pair.first;
-                            current.Append(v);
-                            result.push_back(current);
+                Enumerate all the ways to pick three positions for the epsilon,
+                in lexicographic order, and pair the rest of the positions
+                with ForEachPairing. The callback gets the positions of the
+                epsilon, followed by the ones of the gammas.
+             */
+            template<typename F>
+            void ForEachEpsilonPairing(unsigned n, F callback) const {
+                assert(n >= 3 && n % 2 == 1);
+
+                std::vector<unsigned> rest (n-3);
+                std::vector<unsigned> result (n);
+
+                for (unsigned a=0; a<n; a++) {
+                    for (unsigned b=a+1; b<n; b++) {
+                        for (unsigned c=b+1; c<n; c++) {
+                            // Collect the remaining positions
+                            unsigned pos = 0;
+                            for (unsigned i=0; i<n; i++) {
+                                if (i != a && i != b && i != c) rest[pos++] = i;
+                            }
+
+                            result[0] = a;
+                            result[1] = b;
+                            result[2] = c;
+
+                            if (n == 3) {
+                                callback(result);
+                                continue;
+                            }
+
+                            ForEachPairing(rest, [&](const std::vector<unsigned>& pairs) {
+                                std::copy(pairs.begin(), pairs.end(), result.begin() + 3);
+                                callback(result);
+                            });
                         }
                     }
                 }
+            }
+
+            std::vector<Indices> GenerateEvenRank(const Indices& indices) const {
+                std::vector<unsigned> positions (indices.Size());
+                std::iota(positions.begin(), positions.end(), 0);
+
+                std::vector<Indices> result;
+                ForEachPairing(positions, [&](const std::vector<unsigned>& pairing) {
+                    result.push_back(indices.Select(pairing));
+                });
 
                 return result;
             }
 
             std::vector<Indices> GenerateOddRank(const Indices& indices) const {
-                // Get all the three partitions of indices
-                auto partitions = indices.GetAllPartitions(3);
-
                 std::vector<Indices> result;
-
-                // Iterate over all partitions
-                for (auto& partition : partitions) {
-                    if (partition.second.Size() != 0) {
-                        // Generate the two-partitions of the rest with GenerateEvenRank
-                        auto list = GenerateEvenRank(partition.second);
-
-                        // Iterate over all the possible gamma indices
-                        for (auto &l : list) {
-                            auto current = partition.first;
-                            current.Append(l);
-                            result.push_back(current);
-                        }
-                    } else {
-                        result.push_back(partition.first);
-                    }
-                }
+                ForEachEpsilonPairing(indices.Size(), [&](const std::vector<unsigned>& pairing) {
+                    result.push_back(indices.Select(pairing));
+                });
 
                 return result;
             }
@@ -148,24 +189,165 @@ namespace Construction {
                 unsigned numEpsilon = (indices.Size() % 2 == 0) ? 0 : 1;
                 unsigned numGammas  = (indices.Size() % 2 == 0) ? indices.Size()/2  : (indices.Size()-3)/2;
 
-                std::vector<Indices> possibleIndices;
+                std::vector<Tensor::Tensor> tensors;
+
+                // Stream the index combinations directly into the summands
+                auto emit = [&](const std::vector<unsigned>& positions) {
+                    // Create variable
+                    Tensor::Scalar variable ("e", ++variableCounter);
+
+                    tensors.push_back(variable * Tensor::Tensor::EpsilonGamma(numEpsilon, numGammas, indices.Select(positions)));
+                };
 
                 if (numEpsilon == 1) {
-                    possibleIndices = GenerateOddRank(indices);
+                    ForEachEpsilonPairing(order, emit);
                 } else {
-                    possibleIndices = GenerateEvenRank(indices);
+                    std::vector<unsigned> positions (order);
+                    std::iota(positions.begin(), positions.end(), 0);
+
+                    ForEachPairing(positions, emit);
                 }
 
+                return Tensor::Tensor::Add(std::move(tensors));
+            }
+
+            /**
+                \brief Generate the tensors with the symmetries of a coefficient
+
+                Generate the most general tensor with l + ld + r + rd indices
+                that is symmetric in each of the four blocks and, if requested
+                and the shapes match, under the exchange of (l, ld) with (r, rd).
+
+                Instead of generating all the epsilon-gamma tensors and
+                symmetrizing them afterwards, only one representative of each
+                orbit of the index combinations under the symmetry group is
+                generated. Since the symmetrization maps all the elements of an
+                orbit onto the same tensor (up to the sign), the others would
+                only be discarded later on. The orbits are marked on the index
+                positions, so no tensors are built for them.
+
+                Note that the result may still contain linear dependent terms
+                due to identities in three dimensions, which are not visible
+                on the level of the index combinations.
+             */
+            Tensor::Tensor Generate(unsigned l, unsigned ld, unsigned r, unsigned rd, bool exchange) const {
+                unsigned order = l + ld + r + rd;
+
+                // We cannot build anything with less than two indices
+                if (order < 2) return Tensor::Tensor::Zero();
+
+                // Get index blocks
+                auto block1 = Indices::GetRomanSeries(l, {1,3});
+                auto block2 = Indices::GetRomanSeries(ld, {1,3}, l);
+                auto block3 = Indices::GetRomanSeries(r, {1,3}, l+ld);
+                auto block4 = Indices::GetRomanSeries(rd, {1,3}, l+ld+r);
+
+                auto indices = block1;
+                indices.Append(block2);
+                indices.Append(block3);
+                indices.Append(block4);
+
+                // Generate all the permutations of the positions in the group
+                std::vector<std::vector<unsigned>> group (1, std::vector<unsigned>(order));
+                std::iota(group[0].begin(), group[0].end(), 0);
+
+                std::vector<Indices> symmetrized;
+                std::vector<Indices> blocks;
+
+                unsigned offset = 0;
+                for (auto size : { l, ld, r, rd }) {
+                    if (size > 1) {
+                        symmetrized.push_back(indices.Partial({ offset, offset + size - 1 }));
+
+                        std::vector<std::vector<unsigned>> extended;
+
+                        for (auto& element : group) {
+                            std::vector<unsigned> block (element.begin() + offset, element.begin() + offset + size);
+                            std::sort(block.begin(), block.end());
+
+                            do {
+                                auto current = element;
+                                std::copy(block.begin(), block.end(), current.begin() + offset);
+                                extended.push_back(std::move(current));
+                            } while (std::next_permutation(block.begin(), block.end()));
+                        }
+
+                        group = std::move(extended);
+                    }
+
+                    offset += size;
+                }
+
+                if (exchange && l == r && ld == rd) {
+                    blocks = { indices.Partial({ 0, l+ld-1 }), indices.Partial({ l+ld, order-1 }) };
+
+                    unsigned size = group.size();
+                    for (unsigned i=0; i<size; i++) {
+                        auto current = group[i];
+                        std::rotate(current.begin(), current.begin() + l + ld, current.end());
+                        group.push_back(std::move(current));
+                    }
+                }
+
+                // Normal form of an index combination, i.e. the epsilon and all the
+                // gammas sorted and the gammas sorted among each other
+                unsigned numEpsilon = (order % 2 == 0) ? 0 : 1;
+                unsigned numGammas  = (order % 2 == 0) ? order/2  : (order-3)/2;
+
+                auto normalize = [&](std::vector<unsigned>& positions) {
+                    if (numEpsilon == 1) std::sort(positions.begin(), positions.begin() + 3);
+
+                    std::vector<std::pair<unsigned, unsigned>> pairs;
+                    for (unsigned i=3*numEpsilon; i<order; i += 2) {
+                        pairs.push_back(std::minmax(positions[i], positions[i+1]));
+                    }
+                    std::sort(pairs.begin(), pairs.end());
+
+                    for (unsigned i=0; i<pairs.size(); i++) {
+                        positions[3*numEpsilon + 2*i] = pairs[i].first;
+                        positions[3*numEpsilon + 2*i + 1] = pairs[i].second;
+                    }
+                };
+
+                std::set<std::vector<unsigned>> visited;
+                std::vector<unsigned> image (order);
+
                 std::vector<Tensor::Tensor> tensors;
+                unsigned variableCounter = 0;
+
+                auto emit = [&](const std::vector<unsigned>& positions) {
+                    // Skip the combination if its orbit was already generated
+                    if (visited.find(positions) != visited.end()) return;
+
+                    // Mark the whole orbit
+                    for (auto& element : group) {
+                        for (unsigned i=0; i<order; i++) image[i] = element[positions[i]];
+                        normalize(image);
+                        visited.insert(image);
+                    }
+
+                    // Symmetrize the representative, whole orbits may vanish
+                    auto tensor = Tensor::Tensor::EpsilonGamma(numEpsilon, numGammas, indices.Select(positions)).BlockSymmetrize(blocks, symmetrized);
+                    if (tensor.IsZeroTensor()) return;
 
-                for (auto& newIndices : possibleIndices) {
                     // Create variable
                     Tensor::Scalar variable ("e", ++variableCounter);
 
-                    tensors.push_back(variable * Tensor::Tensor::EpsilonGamma(numEpsilon, numGammas, newIndices));
+                    tensors.push_back(variable * tensor);
+                };
+
+                if (numEpsilon == 1) {
+                    ForEachEpsilonPairing(order, emit);
+                } else {
+                    std::vector<unsigned> positions (order);
+                    std::iota(positions.begin(), positions.end(), 0);
+
+                    ForEachPairing(positions, emit);
                 }
 
-                return Tensor::Tensor::Add(tensors);
+                // Every summand is symmetric on its own, s.t. the number of
+                // linear independent summands is bounded by InvariantDimension
+                return Tensor::Tensor::Add(std::move(tensors));
             }
         };
 
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cassert>
+#include <map>
+#include <vector>
+
+namespace Construction {
+    namespace Generator {
+
+        /**
+            \class InvariantDimension
+
+            \brief Counts the linear independent SO(3) invariant tensors
+
+            Counts the linear independent SO(3) invariant tensors in three
+            dimensions with a given symmetry pattern, i.e. the number of
+            linear independent epsilon-gamma tensors one can build with this
+            symmetry. This is known a-priori from representation theory, s.t.
+            the elimination can stop as soon as that many independent terms
+            are found.
+
+            The number of invariants in a representation W is given by the
+            Weyl integration formula
+
+                dim W^{SO(3)} = 1/\pi \int_0^\pi \chi_W(\theta) (1 - \cos\theta) d\theta
+
+            With z = e^{i\theta} the characters are Laurent polynomials in z
+            and the integral just picks a_0 - a_1 of the coefficients. The
+            character of a rotation on the vectors is z + 1 + z^{-1}, the
+            one of the symmetric powers is obtained by Newton's identities
+            and the exchange of two equal blocks is the symmetric square.
+            Everything is done in integers, since characters have integer
+            coefficients.
+         */
+        class InvariantDimension {
+        private:
+            typedef std::map<int, long long>   Polynomial;
+        public:
+            /**
+                \brief Number of invariant tensors of the given rank without symmetries
+             */
+            static unsigned Compute(unsigned rank) {
+                return Compute(std::vector<unsigned>(rank, 1));
+            }
+
+            /**
+                \brief Number of invariant tensors symmetric in each of the blocks
+
+                \param  blocks  The sizes of the consecutive blocks of symmetric indices
+             */
+            static unsigned Compute(const std::vector<unsigned>& blocks) {
+                return Integrate(Character(blocks, 1));
+            }
+
+            /**
+                \brief Number of invariant tensors with the symmetries of a coefficient
+
+                Number of invariant tensors with l + ld + r + rd indices that are
+                symmetric in each of the four blocks and, if requested and the
+                shapes match, under the exchange of (l, ld) with (r, rd).
+             */
+            static unsigned Compute(unsigned l, unsigned ld, unsigned r, unsigned rd, bool exchange) {
+                if (!exchange || l != r || ld != rd) {
+                    return Compute({ l, ld, r, rd });
+                }
+
+                // Symmetric square of the left block
+                auto first = Character({ l, ld }, 1);
+                auto second = Character({ l, ld }, 2);
+
+                auto character = Multiply(first, first);
+                for (auto& pair : second) {
+                    character[pair.first] += pair.second;
+                }
+
+                for (auto& pair : character) {
+                    assert(pair.second % 2 == 0);
+                    pair.second /= 2;
+                }
+
+                return Integrate(character);
+            }
+        private:
+            static Polynomial Multiply(const Polynomial& a, const Polynomial& b) {
+                Polynomial result;
+                for (auto& x : a) {
+                    for (auto& y : b) {
+                        result[x.first + y.first] += x.second * y.second;
+                    }
+                }
+                return result;
+            }
+
+            /**
+                Character of the rotation by the angle m\theta on the vectors
+             */
+            static Polynomial Vector(int m) {
+                return { { -m, 1 }, { 0, 1 }, { m, 1 } };
+            }
+
+            /**
+                Character of the rotation by m\theta on the tensor product of
+                the symmetric powers of the vectors. The symmetric powers
+                follow from h_k = 1/k \sum_{i=1}^k p_i h_{k-i}.
+             */
+            static Polynomial Character(const std::vector<unsigned>& blocks, int m) {
+                Polynomial result = { { 0, 1 } };
+
+                for (auto size : blocks) {
+                    std::vector<Polynomial> h = { { { 0, 1 } } };
+
+                    for (unsigned k=1; k<=size; k++) {
+                        Polynomial current;
+
+                        for (unsigned i=1; i<=k; i++) {
+                            for (auto& pair : Multiply(Vector(m*i), h[k-i])) {
+                                current[pair.first] += pair.second;
+                            }
+                        }
+
+                        for (auto& pair : current) {
+                            assert(pair.second % k == 0);
+                            pair.second /= k;
+                        }
+
+                        h.push_back(std::move(current));
+                    }
+
+                    result = Multiply(result, h[size]);
+                }
+
+                return result;
+            }
+
+            static unsigned Integrate(const Polynomial& character) {
+                auto zero = character.find(0);
+                auto one = character.find(1);
+
+                long long result = (zero != character.end()) ? zero->second : 0;
+                if (one != character.end()) result -= one->second;
+
+                assert(result >= 0);
+                return static_cast<unsigned>(result);
+            }
+        };
+
+    }
+}
@@ -9,6 +9,7 @@
 #include <common/time_measurement.hpp>
 
 #include <generator/base_tensor.hpp>
+#include <generator/invariant_dimension.hpp>
 
 using Construction::Tensor::Tensor;
 using Construction::Tensor::Scalar;
@@ -42,6 +43,7 @@ namespace Construction {
             Tensor::Tensor Coefficient(unsigned, unsigned, unsigned, unsigned);
 
             size_t DegreesOfFreedom(const Tensor::Tensor& tensor);
+            unsigned ExpectedRank(const Tensor::Tensor& tensor);
 
             Tensor::Tensor Symmetrize(const Tensor::Tensor& tensor, const Indices& indices);
             Tensor::Tensor AntiSymmetrize(const Tensor::Tensor& tensor, const Indices& indices);
@@ -184,9 +186,49 @@ namespace Construction {
                 return result;
             }*/
 
+            /**
+                Returns the number of linear independent summands in the tensor.
+                For tensors that are built of epsilons, gammas and deltas only,
+                the number is bounded by the number of invariant tensors, which
+                allows to stop the elimination early.
+             */
             size_t DegreesOfFreedom(const Tensor::Tensor& tensor) {
-                // TODO: really count the number of variables
-                return tensor.GetSummands().size();
+                if (tensor.IsZeroTensor()) return 0;
+
+                auto simplified = tensor.Simplify(ExpectedRank(tensor));
+                if (simplified.IsZeroTensor()) return 0;
+
+                return simplified.GetSummands().size();
+            }
+
+            /**
+                Returns the number of linear independent SO(3) invariant tensors
+                with the indices of the given tensor, if all the summands are built
+                of epsilons, gammas and deltas in three dimensions. Otherwise zero
+                is returned, i.e. the rank is not known a-priori.
+             */
+            unsigned ExpectedRank(const Tensor::Tensor& tensor) {
+                auto indices = tensor.GetIndices();
+                if (indices.Size() == 0) return 0;
+
+                for (auto& index : indices) {
+                    if (index.GetRange().GetDimension() != 3) return 0;
+                }
+
+                std::function<bool(const Tensor::AbstractTensor&)> isInvariant = [&](const Tensor::AbstractTensor& t) -> bool {
+                    if (t.IsEpsilonTensor() || t.IsGammaTensor() || t.IsEpsilonGammaTensor() || t.IsDeltaTensor()) return true;
+                    if (t.IsMultipliedTensor()) {
+                        auto& multiplied = static_cast<const Tensor::MultipliedTensor&>(t);
+                        return isInvariant(*multiplied.GetFirst()) && isInvariant(*multiplied.GetSecond());
+                    }
+                    return false;
+                };
+
+                for (auto& summand : tensor.GetSummands()) {
+                    if (!isInvariant(*summand.SeparateScalefactor().second.As<Tensor::AbstractTensor>())) return 0;
+                }
+
+                return Generator::InvariantDimension::Compute(indices.Size());
             }
 
             Tensor::Tensor Symmetrize(const Tensor::Tensor& tensor, const Indices& indices) {
@@ -201,13 +243,8 @@ namespace Construction {
                 return tensor.ExchangeSymmetrize(from, indices);
             }
 
-            Tensor::Tensor BlockSymmetrize(const Tensor::Tensor& tensors, const std::vector<Indices>& blocks) {
-                // TODO: implement
-                return tensors;
-
-                //Construction::Generator::BlockSymmetrizedTensorGenerator symmetrizer(blocks);
-                //auto result = symmetrizer(tensors);
-                //return result;
+            Tensor::Tensor BlockSymmetrize(const Tensor::Tensor& tensor, const std::vector<Indices>& blocks) {
+                return tensor.BlockSymmetrize(blocks);
             }
 
             Tensor::Tensor Expand(const Tensor::Tensor& tensor) {
@@ -215,7 +252,7 @@ namespace Construction {
             }
 
             Tensor::Tensor Simplify(const Tensor::Tensor& tensor) {
-                return tensor.Simplify();
+                return tensor.Simplify(ExpectedRank(tensor));
             }
 
             Tensor::Tensor RedefineVariables(const Tensor::Tensor& tensor) {
@@ -297,7 +334,7 @@ namespace Construction {
                 // Simplify and thus get rid of all the linear dependent ones
                 // The linear independent ones are the remaining ones
                 // TODO: keep the original scale of the tensor
-                tensor = tensor.Simplify();
+                tensor = tensor.Simplify(ExpectedRank(tensor));
 
                 return tensor.GetSummands();
             }
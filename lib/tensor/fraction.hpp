@@ -196,6 +196,9 @@ namespace Construction {
             virtual ScalarPointer Clone() const override {
                 return std::move(ScalarPointer(new FractionBase(numerator, denominator)));
             }
+        public:
+            const T& GetNumerator() const { return numerator; }
+            const T& GetDenominator() const { return denominator; }
         public:
             virtual void Serialize(std::ostream& os) const override {
                 // Call parent
@@ -4,6 +4,9 @@
 #include <vector>
 #include <sstream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
 #include <algorithm>
 
 #include <tensor/expression.hpp>
@@ -394,6 +397,182 @@ namespace Construction {
 			std::map<std::string, unsigned> assignment;
 		};
 
+		/**
+			\class IndexCombinations
+
+			\brief Lazy sequence of all the index combinations
+
+			Lazy sequence of all the index combinations for a list of
+			ranges. The iterator works like an odometer on one fixed
+			array, i.e. the last index is increased first and carries
+			over to the previous one. Thus, stepping through the combinations
+			does not allocate any memory. In C++11 this allows
+
+				for (auto& combination : indices.GetIndexCombinations()) {
+					// do calculation
+				}
+
+			The order is the same as in Indices::GetAllIndexCombinations().
+		 */
+		class IndexCombinations {
+		public:
+			explicit IndexCombinations(const std::vector<Range>& ranges) {
+				for (auto& range : ranges) {
+					from.push_back(range.GetFrom());
+					to.push_back(range.GetTo());
+				}
+			}
+		public:
+			class Iterator {
+			public:
+				Iterator(const IndexCombinations* parent, bool finished) : parent(parent), current(parent->from), finished(finished) { }
+			public:
+				const std::vector<unsigned>& operator*() const {
+					return current;
+				}
+
+				bool operator!=(const Iterator& it) const {
+					return finished != it.finished || (!finished && current != it.current);
+				}
+
+				Iterator& operator++() {
+					// Increase the last index and carry over
+					int k = current.size()-1;
+					while (k >= 0 && current[k] == parent->to[k]) {
+						current[k] = parent->from[k];
+						--k;
+					}
+
+					if (k < 0) finished = true;
+					else ++current[k];
+
+					return *this;
+				}
+			private:
+				const IndexCombinations* parent;
+				std::vector<unsigned> current;
+				bool finished;
+			};
+
+			Iterator begin() const { return Iterator(this, false); }
+			Iterator end() const { return Iterator(this, true); }
+		public:
+			/**
+				Number of combinations
+			 */
+			size_t Size() const {
+				size_t result = 1;
+				for (unsigned i=0; i<from.size(); ++i) {
+					result *= to[i] - from[i] + 1;
+				}
+				return result;
+			}
+
+			unsigned GetRank() const { return from.size(); }
+		private:
+			std::vector<unsigned> from;
+			std::vector<unsigned> to;
+		};
+
+		/**
+			\class IndexCombinationTable
+
+			\brief Flat table of index combinations
+
+			Stores a list of index combinations in one contiguous array
+			with one row of `rank` values per combination. The table
+			with all the combinations of a given rank and range is
+			calculated only once and shared, see Get().
+		 */
+		class IndexCombinationTable {
+		public:
+			explicit IndexCombinationTable(unsigned rank=0) : rank(rank), size(0) { }
+
+			explicit IndexCombinationTable(const IndexCombinations& combinations) : rank(combinations.GetRank()), size(0) {
+				Reserve(combinations.Size());
+
+				for (auto& combination : combinations) {
+					Append(combination);
+				}
+			}
+
+			IndexCombinationTable(const std::vector<std::vector<unsigned>>& combinations) : rank(0), size(0) {
+				if (combinations.size() > 0) rank = combinations[0].size();
+
+				Reserve(combinations.size());
+
+				for (auto& combination : combinations) {
+					Append(combination);
+				}
+			}
+		public:
+			unsigned GetRank() const { return rank; }
+			size_t Size() const { return size; }
+
+			/**
+				Pointer to the values of the i-th combination
+			 */
+			const unsigned* operator[](size_t i) const {
+				return values.data() + i*rank;
+			}
+
+			std::vector<unsigned> At(size_t i) const {
+				return std::vector<unsigned>((*this)[i], (*this)[i] + rank);
+			}
+		public:
+			void Reserve(size_t n) {
+				values.reserve(n*rank);
+			}
+
+			void Append(const unsigned* combination) {
+				values.insert(values.end(), combination, combination + rank);
+				++size;
+			}
+
+			void Append(const std::vector<unsigned>& combination) {
+				assert(combination.size() == rank);
+				Append(combination.data());
+			}
+
+			std::vector<std::vector<unsigned>> ToVector() const {
+				std::vector<std::vector<unsigned>> result;
+				result.reserve(size);
+
+				for (size_t i=0; i<size; ++i) {
+					result.push_back(At(i));
+				}
+
+				return result;
+			}
+		public:
+			/**
+				\brief Returns the shared table of all combinations
+
+				Returns the table of all the index combinations for
+				`rank` indices in the given range. The table is only
+				generated on the first call and then shared.
+			 */
+			static std::shared_ptr<const IndexCombinationTable> Get(unsigned rank, const Range& range) {
+				static std::mutex mutex;
+				static std::map<std::tuple<unsigned, unsigned, unsigned>, std::shared_ptr<const IndexCombinationTable>> tables;
+
+				std::unique_lock<std::mutex> lock(mutex);
+
+				auto key = std::make_tuple(rank, range.GetFrom(), range.GetTo());
+				auto it = tables.find(key);
+				if (it != tables.end()) return it->second;
+
+				auto table = std::make_shared<const IndexCombinationTable>(IndexCombinations(std::vector<Range>(rank, range)));
+				tables.insert({ key, table });
+
+				return table;
+			}
+		private:
+			unsigned rank;
+			size_t size;
+			std::vector<unsigned> values;
+		};
+
 		/**
 			\class Indices
 		 */
@@ -441,6 +620,18 @@ namespace Construction {
 				}
 				return result;
 			}
+
+			/**
+				\brief Returns the indices at the given positions in this order
+			 */
+			Indices Select(const std::vector<unsigned>& positions) const {
+				Indices result;
+				result.indices.reserve(positions.size());
+				for (auto i : positions) {
+					result.indices.push_back(indices[i]);
+				}
+				return result;
+			}
 		public:
 			void Insert(const Index& index) {
 				indices.push_back(index);
@@ -767,42 +958,55 @@ namespace Construction {
 				\brief Returns all the possible index combinations for the tensor.
 
 			 	Returns all the possible index combinations for the tensor.
-			 	It uses a recursive inline methods that fixes the indices one by one
-			 	until all indices have a value. In this case the combination is added to the
-			 	result.
+			 	If one only needs to iterate over the combinations, prefer
+			 	GetIndexCombinations() or GetIndexCombinationTable() which
+			 	do not allocate a vector for each combination.
 			 */
 			std::vector<std::vector<unsigned>> GetAllIndexCombinations() const {
+				auto combinations = GetIndexCombinations();
 
-				// Result
 				std::vector<std::vector<unsigned>> result;
+				result.reserve(combinations.Size());
 
-				// Helper method to recursively determine the index combinations
-				std::function<void(const std::vector<unsigned>&)> fn = [&](const std::vector<unsigned>& input) -> void {
-					// If all indices are fixed, add the combination to the list
-					if (input.size() == Size()) {
-						result.push_back(input);
-						return;
-					}
+				for (auto& combination : combinations) {
+					result.push_back(combination);
+				}
 
-					// Get range of next unfixed index
-					auto range = indices[input.size()].GetRange();
+				return result;
+			}
 
-					// Iterate over the range
-					for (auto i : range) {
-						// Add the index to the list
-						std::vector<unsigned> newInput = input;
-						newInput.push_back(i);
+			/**
+				\brief Returns a lazy sequence of all the index combinations
+			 */
+			IndexCombinations GetIndexCombinations() const {
+				std::vector<Range> ranges;
+				for (auto& index : indices) {
+					ranges.push_back(index.GetRange());
+				}
+				return IndexCombinations(ranges);
+			}
+
+			/**
+				\brief Returns the table of all the index combinations
 
-						// Recursive call to go to next index
-						fn(newInput);
+				Returns the flat table of all the index combinations. If all
+				the indices have the same range, the shared table for this rank
+				and range is returned, otherwise a new one is generated.
+			 */
+			std::shared_ptr<const IndexCombinationTable> GetIndexCombinationTable() const {
+				if (indices.size() > 0) {
+					bool equal = true;
+					for (auto& index : indices) {
+						if (index.GetRange() != indices[0].GetRange()) {
+							equal = false;
+							break;
+						}
 					}
-				};
 
-				// Start recursion
-				std::vector<unsigned> input;
-				fn({});
+					if (equal) return IndexCombinationTable::Get(indices.size(), indices[0].GetRange());
+				}
 
-				return result;
+				return std::make_shared<const IndexCombinationTable>(GetIndexCombinations());
 			}
 		public:
 			static Indices GetSeries(unsigned N, const std::string& name, const std::string& printed, const Range& range, unsigned offset=0) {
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <tensor/fraction.hpp>
+
+namespace Construction {
+    namespace Tensor {
+
+        /**
+            \class Modular
+
+            \brief Integer modulo the prime 2^31 - 1
+
+            Allows exact elimination on matrices whose intermediate fractions
+            would overflow, e.g. Gram matrices, by using it as the entries of a
+            `Vector::Matrix`. Fractions with small numerator and denominator
+            compared to the prime are recovered afterwards by rational
+            reconstruction. Since this fails for unlucky primes, the results
+            have to be checked in the fractions.
+         */
+        class Modular {
+        public:
+            static constexpr long long Prime = 2147483647;
+        public:
+            Modular() : value(0) { }
+            Modular(long long number) : value(number % Prime) {
+                if (value < 0) value += Prime;
+            }
+
+            /**
+                \brief Maps the fraction into the field
+
+                The denominator must not be divisible by the prime, see
+                IsRepresentable().
+             */
+            Modular(const Fraction& fraction) : Modular(Modular(fraction.GetNumerator()) / Modular(fraction.GetDenominator())) { }
+        public:
+            static bool IsRepresentable(const Fraction& fraction) {
+                return fraction.GetDenominator() % Prime != 0;
+            }
+        public:
+            bool operator==(const Modular& other) const { return value == other.value; }
+            bool operator!=(const Modular& other) const { return value != other.value; }
+
+            Modular operator-() const { return Modular(Prime - value); }
+
+            Modular operator+(const Modular& other) const { return Modular(value + other.value); }
+            Modular operator-(const Modular& other) const { return Modular(value - other.value); }
+            Modular operator*(const Modular& other) const { return Modular(value * other.value); }
+            Modular operator/(const Modular& other) const { return *this * other.Inverse(); }
+
+            /**
+                \brief Multiplicative inverse by Fermat's little theorem
+             */
+            Modular Inverse() const {
+                assert(value != 0);
+
+                long long result = 1;
+                long long base = value;
+
+                for (long long exponent = Prime - 2; exponent > 0; exponent >>= 1) {
+                    if (exponent & 1) result = (result * base) % Prime;
+                    base = (base * base) % Prime;
+                }
+
+                return Modular(result);
+            }
+
+            /**
+                \brief Rational reconstruction
+
+                Finds the fraction a/b with |a|, b below sqrt(Prime/2) that is
+                mapped to this value, by the extended Euclidean algorithm.
+
+                \param      result      The reconstructed fraction
+                \returns    True if there is such a fraction
+             */
+            bool ToFraction(Fraction& result) const {
+                const long long bound = 32767;
+
+                long long r0 = Prime, r1 = value;
+                long long t0 = 0, t1 = 1;
+
+                while (r1 > bound) {
+                    long long q = r0 / r1;
+
+                    long long r = r0 - q * r1;
+                    r0 = r1;
+                    r1 = r;
+
+                    long long t = t0 - q * t1;
+                    t0 = t1;
+                    t1 = t;
+                }
+
+                if (t1 == 0 || t1 > bound || t1 < -bound) return false;
+
+                // The fraction has to be in lowest terms
+                result = Fraction(r1, t1);
+                result.Reduce();
+
+                return result.GetDenominator() == (t1 > 0 ? t1 : -t1);
+            }
+        private:
+            long long value;
+        };
+
+    }
+}
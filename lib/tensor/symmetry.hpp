@@ -1,5 +1,10 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
+#include <tensor/index.hpp>
+
 namespace Construction {
     namespace Tensor {
 
@@ -97,12 +102,29 @@ namespace Construction {
                 type = (symmetric) ? Type::SYMMETRY : Type::ANTISYMMETRY;
                 for (auto& i : indices) {
                     blocks.push_back({ i,i });
+                    positions.push_back({ i });
                 }
             }
 
             ElementarySymmetry(const std::vector<std::pair<unsigned, unsigned>>& blocks, bool symmetric=true) {
                 type = (symmetric) ? Type::BLOCKSYMMETRY : Type::ANTIBLOCKSYMMETRY;
                 this->blocks = blocks;
+
+                for (auto& block : blocks) {
+                    positions.push_back({});
+                    for (unsigned i=block.first; i<=block.second; ++i) positions.back().push_back(i);
+                }
+            }
+
+            /**
+                Exchange symmetry of blocks whose indices are not next to each other.
+                The i-th index of one block is exchanged with the i-th of the others.
+             */
+            ElementarySymmetry(const std::vector<std::vector<unsigned>>& blocks, bool symmetric=true) : positions(blocks) {
+                type = (symmetric) ? Type::BLOCKSYMMETRY : Type::ANTIBLOCKSYMMETRY;
+                for (auto& block : blocks) {
+                    this->blocks.push_back({ block.front(), block.back() });
+                }
             }
         public:
             bool IsEqual(const Indices& first, const Indices& second, bool ignoreSign=false) const {
@@ -136,13 +158,53 @@ namespace Construction {
                     } else return Permutation::From(trimmedFirst, trimmedSecond).IsEven();
                 }
             }
+
+            /**
+                \brief Checks if the index combination is canonical under the symmetry
+
+                The combination is canonical if the values of the blocks are in
+                lexicographic order, strictly for antisymmetries. For single indices
+                this means sorted for symmetric and strictly increasing for
+                antisymmetric indices. All the other components are equal to a
+                canonical one up to a sign or vanish.
+
+                \param      combination     The values of all the indices
+                \returns    True if the combination is canonical
+             */
+            bool IsCanonical(const unsigned* combination) const {
+                bool symmetric = (type == Type::SYMMETRY || type == Type::BLOCKSYMMETRY);
+
+                for (unsigned i=1; i<positions.size(); ++i) {
+                    auto& previous = positions[i-1];
+                    auto& current = positions[i];
+
+                    // Compare the blocks lexicographically
+                    int comparison = 0;
+                    for (unsigned k=0; k<current.size() && comparison == 0; ++k) {
+                        if (combination[current[k]] < combination[previous[k]]) comparison = -1;
+                        else if (combination[current[k]] > combination[previous[k]]) comparison = 1;
+                    }
+
+                    if (comparison < 0 || (comparison == 0 && !symmetric)) return false;
+                }
+
+                return true;
+            }
         private:
             std::vector<std::pair<unsigned, unsigned>> blocks;
+            std::vector<std::vector<unsigned>> positions;
             Type type;
         };
 
         /**
             \class Symmetry
+
+            \brief Symmetries of the index positions of a tensor
+
+            The elementary symmetries are given by the positions of the indices.
+            If blocks are exchanged, the symmetric sets of indices in them have to be
+            exchanged with each other, s.t. the canonical index combinations of all
+            the elementary symmetries together are representatives of all components.
          */
         class Symmetry {
         public:
@@ -150,12 +212,45 @@ namespace Construction {
                 symmetries.push_back(symmetry);
             }
 
+            bool IsEmpty() const { return symmetries.empty(); }
+
             bool IsEqual(const Indices& first, const Indices& second, bool ignoreSign=false) const {
                 for (auto& symmetry : symmetries) {
                     if (!symmetry.IsEqual(first, second, ignoreSign)) return false;
                 }
                 return true;
             }
+
+            bool IsCanonical(const unsigned* combination) const {
+                for (auto& symmetry : symmetries) {
+                    if (!symmetry.IsCanonical(combination)) return false;
+                }
+                return true;
+            }
+
+            /**
+                \brief Returns the canonical index combinations of the indices
+
+                Returns the index combinations of the indices that are canonical
+                under all the symmetries. A tensor with these symmetries is already
+                determined by its components on these, s.t. the other ones do not
+                have to be evaluated.
+
+                \param      indices     The indices of the tensor
+                \returns    The table of the canonical index combinations
+             */
+            std::shared_ptr<const IndexCombinationTable> GetIndexCombinationTable(const Indices& indices) const {
+                auto all = indices.GetIndexCombinationTable();
+                if (IsEmpty()) return all;
+
+                auto result = std::make_shared<IndexCombinationTable>(all->GetRank());
+
+                for (size_t i=0; i<all->Size(); ++i) {
+                    if (IsCanonical((*all)[i])) result->Append((*all)[i]);
+                }
+
+                return result;
+            }
         private:
             std::vector<ElementarySymmetry> symmetries;
         };
@@ -6,11 +6,14 @@
 #include <numeric>
 #include <cmath>
 #include <memory>
+#include <unordered_map>
 
 #include <common/task_pool.hpp>
 #include <common/logger.hpp>
+#include <common/cancellation.hpp>
 #include <tensor/permutation.hpp>
 #include <tensor/fraction.hpp>
+#include <tensor/modular.hpp>
 #include <tensor/symmetry.hpp>
 #include <tensor/expression.hpp>
 
@@ -92,7 +95,7 @@ namespace Construction {
 				CUSTOM = -1
 			};
 		public:
-			AbstractTensor() : Printable("") { }
+			AbstractTensor() : Printable(""), type(TensorType::CUSTOM) { }
 
 			/**
 				Constructor of a Tensor
@@ -102,7 +105,7 @@ namespace Construction {
 			 	\param indices		The indices of the tensor
 			 */
 			AbstractTensor(const std::string& name, const std::string& printable, const Indices& indices)
-				: name(name), Printable(printable), indices(indices) { }
+				: name(name), Printable(printable), indices(indices), type(TensorType::CUSTOM) { }
 
 			// Copy constructor
 			AbstractTensor(const AbstractTensor& other)
@@ -156,6 +159,64 @@ namespace Construction {
 			virtual bool operator!=(const AbstractTensor& other) const {
                 return !(*this == other);
 			}
+		public:
+			/**
+				\brief Structural hash of the tensor
+
+				Hash of the structure of the tensor, i.e. of its type, name
+				and indices and for composite tensors of their children.
+				Identical tensors (see IsIdentical) have the same hash.
+			 */
+			virtual size_t Hash() const {
+				size_t seed = HashCombine(std::hash<int>()(static_cast<int>(type)), std::hash<std::string>()(name));
+				seed = HashCombine(seed, std::hash<std::string>()(printed_text));
+				return HashCombine(seed, Hash(indices));
+			}
+
+			/**
+				\brief Structural equality
+
+				Checks if the other tensor has exactly the same structure, i.e.
+				if both are printed the same way. In contrast to IsEqual no
+				components are evaluated and in contrast to operator== sums and
+				products are compared in order. This is the notion we need to
+				collect like terms in canonicalized expressions.
+			 */
+			virtual bool IsIdentical(const AbstractTensor& other) const {
+				return type == other.type && name == other.name && printed_text == other.printed_text && IsIdentical(indices, other.indices);
+			}
+		protected:
+			static size_t HashCombine(size_t seed, size_t value) {
+				return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+			}
+
+			static size_t Hash(const Indices& indices) {
+				size_t seed = indices.Size();
+				for (auto& index : indices) {
+					seed = HashCombine(seed, std::hash<std::string>()(index.GetName()));
+					seed = HashCombine(seed, index.IsContravariant());
+				}
+				return seed;
+			}
+
+			static size_t Hash(const Scalar& scalar) {
+				// Numbers that are equal have the same double value, the other
+				// scalars are only distinguished by IsIdentical
+				if (scalar.IsNumeric()) return std::hash<double>()(scalar.ToDouble());
+				if (scalar.IsVariable()) return 1;
+				if (scalar.IsAdded()) return 2;
+				return 3;
+			}
+
+			static bool IsIdentical(const Indices& a, const Indices& b) {
+				if (a.Size() != b.Size()) return false;
+
+				for (unsigned i=0; i<a.Size(); ++i) {
+					if (a[i] != b[i] || a[i].IsContravariant() != b[i].IsContravariant()) return false;
+				}
+
+				return true;
+			}
 		public:
 			/**
 				Check if two tensors are completely equal, i.e.
@@ -165,11 +226,8 @@ namespace Construction {
 				// If the indices do not match, the tensors are clearly not equal
 				if (indices != other.indices) return false;
 
-				// Get all index combinations
-				auto combinations = GetAllIndexCombinations();
-
 				// Iterate over all index combinations
-				for (auto& combination : combinations) {
+				for (auto& combination : indices.GetIndexCombinations()) {
 					// if the components do not match => return false
 					if (Evaluate(combination) != other(combination)) return false;
 				}
@@ -265,6 +323,92 @@ namespace Construction {
 			inline Scalar operator()(const std::vector<unsigned>& indices) const {
 				return Evaluate(indices);
 			}
+		public:
+			/**
+				\brief Evaluate the tensor on a whole list of index combinations
+
+				Evaluate the tensor on a whole list of index combinations at once.
+				The values in each combination are given in the order of the indices
+				of this tensor. The standard implementation simply calls Evaluate
+				for every combination, composite tensors override it to evaluate
+				their children only once per column.
+
+				\param combinations	The index combinations
+				\returns			The tensor components, one per combination
+			 */
+			virtual std::vector<Scalar> EvaluateColumn(const IndexCombinationTable& combinations) const {
+				std::vector<Scalar> result;
+				result.reserve(combinations.Size());
+
+				std::vector<unsigned> args (combinations.GetRank());
+
+				for (size_t j=0; j<combinations.Size(); ++j) {
+					args.assign(combinations[j], combinations[j] + combinations.GetRank());
+					result.push_back(Evaluate(args));
+				}
+
+				return result;
+			}
+
+			/**
+				\brief Evaluate all the components of the tensor
+
+				Evaluate all the components of the tensor. The result is
+				ordered like GetAllIndexCombinations().
+			 */
+			std::vector<Scalar> EvaluateAll() const {
+				return EvaluateColumn(*GetIndices().GetIndexCombinationTable());
+			}
+
+			/**
+				\brief Rearrange index combinations into another index order
+
+				Takes a list of index combinations where the values are given in
+				the order of `from` and returns the same combinations with the
+				values in the order of `to`. Indices are matched by name, exactly
+				like in an IndexAssignments object.
+
+				If the order does not change, the combinations are returned
+				as they are, s.t. shared tables are not copied. Otherwise the
+				rearranged combinations are written into `storage`.
+
+				\returns	Either `combinations` or `storage`
+				\throws IncompleteIndexAssignmentException
+			 */
+			static const IndexCombinationTable& ReorderCombinations(const Indices& from, const Indices& to, const IndexCombinationTable& combinations, IndexCombinationTable& storage) {
+				// Find the position of every target index in the source
+				std::vector<unsigned> positions;
+				bool identity = from.Size() == to.Size();
+
+				for (unsigned i=0; i<to.Size(); ++i) {
+					unsigned j=0;
+					while (j < from.Size() && from[j].GetName() != to[i].GetName()) ++j;
+
+					if (j == from.Size()) {
+						throw IncompleteIndexAssignmentException();
+					}
+
+					positions.push_back(j);
+					identity = identity && i == j;
+				}
+
+				if (identity) return combinations;
+
+				// Permute the values
+				storage = IndexCombinationTable(positions.size());
+				storage.Reserve(combinations.Size());
+
+				std::vector<unsigned> newCombination (positions.size());
+
+				for (size_t j=0; j<combinations.Size(); ++j) {
+					for (unsigned i=0; i<positions.size(); ++i) {
+						newCombination[i] = combinations[j][positions[i]];
+					}
+					storage.Append(newCombination);
+				}
+
+				return storage;
+			}
 		public:
 			/**
 				\brief Brings the indices in normal order
@@ -371,6 +515,15 @@ namespace Construction {
 			 	\throws CannotAddTensorsException
 			 */
 			static std::unique_ptr<AbstractTensor> Add(const AbstractTensor& one, const AbstractTensor& second);
+
+			/**
+				\brief Addition of two tensors that are given away
+
+			 	Same as above, but takes the ownership of both tensors. Thus,
+			 	nothing has to be cloned and adding a tensor to a sum
+			 	just appends it to the list of summands.
+			 */
+			static std::unique_ptr<AbstractTensor> Add(std::unique_ptr<AbstractTensor> one, std::unique_ptr<AbstractTensor> second);
 		public:
 			/**
 				\brief Checks if all the ranges are equal
@@ -413,11 +566,8 @@ namespace Construction {
 			 	not yield zero.
 			 */
 			bool IsZero() const {
-				// Get all index combinations
-				auto combinations = GetAllIndexCombinations();
-
 				// Iterate over all combinations
-				for (auto& combination : combinations) {
+				for (auto& combination : indices.GetIndexCombinations()) {
 					auto r = Evaluate(combination);
 					if (r.HasVariables() || r.ToDouble() != 0) return false;
 					//if (Evaluate(combination) != 0) return false;
@@ -446,9 +596,29 @@ namespace Construction {
 			//EvaluationFunction evaluator;
 		};
 
-		// Syntactic sugar for pointers to tensors
+		// Syntactic sugar for pointers to tensors. Freshly created nodes are
+		// handed around as TensorPointer, once they become part of a tree they
+		// are immutable and can be shared by several parents via ConstTensorPointer.
 		typedef std::unique_ptr<AbstractTensor> TensorPointer;
-		typedef std::unique_ptr<const AbstractTensor> ConstTensorPointer;
+		typedef std::shared_ptr<const AbstractTensor> ConstTensorPointer;
+
+		/**
+			Hash functor for the structure of a tensor, see AbstractTensor::Hash
+		 */
+		struct TensorStructureHash {
+			size_t operator()(const AbstractTensor* tensor) const {
+				return tensor->Hash();
+			}
+		};
+
+		/**
+			Equality functor for the structure of a tensor, see AbstractTensor::IsIdentical
+		 */
+		struct TensorStructureEqual {
+			bool operator()(const AbstractTensor* a, const AbstractTensor* b) const {
+				return a->IsIdentical(*b);
+			}
+		};
 
 		/**
 			\class AddedTensor
@@ -462,7 +632,7 @@ namespace Construction {
 			/**
 				Constructor of an AddedTensor
 			 */
-			AddedTensor(TensorPointer A, TensorPointer B)
+			AddedTensor(ConstTensorPointer A, ConstTensorPointer B)
 				: AbstractTensor("", "", A->GetIndices()) {
 
 				type = TensorType::ADDITION;
@@ -470,7 +640,7 @@ namespace Construction {
 				summands.push_back(std::move(B));
 			}
 
-			AddedTensor(std::vector<TensorPointer>&& vec, const Indices& indices) {
+			AddedTensor(std::vector<ConstTensorPointer>&& vec, const Indices& indices) {
 				type = TensorType::ADDITION;
 				summands = std::move(vec);
                 this->indices = indices;
@@ -478,24 +648,44 @@ namespace Construction {
 				//if (summands.size() > 0) indices = summands[0]->GetIndices();
 			}
 		public:
-			void AddFromRight(TensorPointer A) {
+			void AddFromRight(ConstTensorPointer A) {
 				summands.push_back(std::move(A));
 			}
 
-			void AddFromLeft(TensorPointer A) {
+			void AddFromLeft(ConstTensorPointer A) {
 				summands.insert(summands.begin(), std::move(A));
 			}
 
-			virtual ~AddedTensor() = default;
-		public:
-			virtual TensorPointer Clone() const override {
-				std::vector<TensorPointer> newSummands;
+			/**
+				Moves all the summands of the other sum to the end of this one
+			 */
+			void AddFromRight(AddedTensor&& other) {
+				summands.reserve(summands.size() + other.summands.size());
 
-				for (auto& tensor : summands) {
-                    auto t = std::move(tensor->Clone());
-					newSummands.emplace_back(std::move(t));
+				for (auto& tensor : other.summands) {
+					summands.push_back(std::move(tensor));
 				}
 
+				other.summands.clear();
+			}
+
+			/**
+				Moves the summands out of the sum, which is left empty
+			 */
+			std::vector<ConstTensorPointer> ReleaseSummands() {
+				std::vector<ConstTensorPointer> result;
+				result.swap(summands);
+				return result;
+			}
+
+			virtual ~AddedTensor() = default;
+		public:
+			/**
+				Clone the sum. The summands are immutable and therefore
+				shared with the clone instead of being copied.
+			 */
+			virtual TensorPointer Clone() const override {
+				std::vector<ConstTensorPointer> newSummands (summands);
 				return std::move(TensorPointer(new AddedTensor(std::move(newSummands), indices)));
 			}
 		public:
@@ -504,7 +694,7 @@ namespace Construction {
 			 */
 			virtual std::string ToString() const override;
 		public:
-			const TensorPointer& At(unsigned id) const { return summands[id]; }
+			const ConstTensorPointer& At(unsigned id) const { return summands[id]; }
 			size_t Size() const { return summands.size(); }
         public:
             virtual Indices GetIndices() const override {
@@ -530,7 +720,7 @@ namespace Construction {
 			}
 
 			static TensorPointer DoDeserialize(std::istream& is, const Indices& indices) {
-				std::vector<TensorPointer> summands;
+				std::vector<ConstTensorPointer> summands;
 
 				// Read size
 				size_t size;
@@ -560,9 +750,12 @@ namespace Construction {
                     mapping[oldIndices[i]] = indices[i];
                 }
 
-				// Need to permute indices in all the summands
+				// Need to permute indices in all the summands. Since they
+				// might be shared with other tensors, copy them before
 				for (auto& tensor : summands) {
-					tensor->SetIndices(tensor->GetIndices().Shuffle(mapping));
+					auto newTensor = tensor->Clone();
+					newTensor->SetIndices(tensor->GetIndices().Shuffle(mapping));
+					tensor = std::move(newTensor);
 				}
 			}
 		public:
@@ -603,18 +796,43 @@ namespace Construction {
 				return result;
 			}
 
+			/**
+				\brief Evaluate the sum on a list of index combinations
+
+				Evaluates every summand on the whole column, with the
+				combinations rearranged to the index order of the summand,
+				and adds up the resulting vectors.
+			 */
+			virtual std::vector<Scalar> EvaluateColumn(const IndexCombinationTable& combinations) const override {
+				auto indices = GetIndices();
+
+				std::vector<Scalar> result (combinations.Size(), Scalar(0));
+
+				IndexCombinationTable reordered;
+
+				for (auto& tensor : summands) {
+					auto column = tensor->EvaluateColumn(ReorderCombinations(indices, tensor->GetIndices(), combinations, reordered));
+
+					for (unsigned j=0; j<column.size(); ++j) {
+						result[j] += column[j];
+					}
+				}
+
+				return result;
+			}
+
 			/**
 				Canonicalize a sum of two tensors
 			 */
 			virtual TensorPointer Canonicalize() const override {
-				std::vector<TensorPointer> newSummands;
+				std::vector<ConstTensorPointer> newSummands;
 
 				for (auto& tensor : summands) {
 					newSummands.push_back(std::move(tensor->Canonicalize()));
 				}
 
 				// Sort the summands by their indices
-				std::sort(newSummands.begin(), newSummands.end(), [](const TensorPointer& a, const TensorPointer& b) {
+				std::sort(newSummands.begin(), newSummands.end(), [](const ConstTensorPointer& a, const ConstTensorPointer& b) {
 					return a->GetIndices() < b->GetIndices();
 				});
 
@@ -623,7 +841,7 @@ namespace Construction {
         public:
             virtual std::unique_ptr<AbstractTensor> MultiplicationHeuristics(const AbstractTensor& other) const override {
                 // Create new list
-                std::vector<TensorPointer> newSummands;
+                std::vector<ConstTensorPointer> newSummands;
 
                 for (auto& tensor : summands) {
                     auto newTensor = tensor->MultiplicationHeuristics(other);
@@ -634,8 +852,29 @@ namespace Construction {
 
                 return std::move(TensorPointer(new AddedTensor(std::move(newSummands), indices)));
             }
+        public:
+            virtual size_t Hash() const override {
+                size_t seed = static_cast<size_t>(type);
+                for (auto& tensor : summands) {
+                    seed = HashCombine(seed, tensor->Hash());
+                }
+                return seed;
+            }
+
+            virtual bool IsIdentical(const AbstractTensor& other) const override {
+                if (!other.IsAddedTensor()) return false;
+
+                auto& _other = static_cast<const AddedTensor&>(other);
+                if (summands.size() != _other.summands.size()) return false;
+
+                for (unsigned i=0; i<summands.size(); ++i) {
+                    if (!summands[i]->IsIdentical(*_other.summands[i])) return false;
+                }
+
+                return true;
+            }
 		private:
-			std::vector<TensorPointer> summands;
+			std::vector<ConstTensorPointer> summands;
 		};
 
 		/**
@@ -653,7 +892,7 @@ namespace Construction {
 		 */
 		class MultipliedTensor : public AbstractTensor {
 		public:
-			MultipliedTensor(TensorPointer A, TensorPointer B)
+			MultipliedTensor(ConstTensorPointer A, ConstTensorPointer B)
 				: AbstractTensor("", "", A->GetIndices().Contract(B->GetIndices())), A(std::move(A)), B(std::move(B))
 			{
 				type = TensorType::MULTIPLICATION;
@@ -662,10 +901,7 @@ namespace Construction {
 			virtual ~MultipliedTensor() = default;
 		public:
 			virtual TensorPointer Clone() const override {
-				return std::move(TensorPointer(new MultipliedTensor(
-					std::move(A->Clone()),
-					std::move(B->Clone())
-				)));
+				return std::move(TensorPointer(new MultipliedTensor(A, B)));
 			}
 		public:
 			virtual void SetIndices(const Indices& newIndices) override {
@@ -677,8 +913,14 @@ namespace Construction {
 
                 indices = newIndices;
 
-                A->SetIndices(A->GetIndices().Shuffle(mapping));
-                B->SetIndices(B->GetIndices().Shuffle(mapping));
+                // The factors might be shared, so relabel copies of them
+                auto newA = A->Clone();
+                newA->SetIndices(A->GetIndices().Shuffle(mapping));
+                A = std::move(newA);
+
+                auto newB = B->Clone();
+                newB->SetIndices(B->GetIndices().Shuffle(mapping));
+                B = std::move(newB);
 			}
 		public:
 			virtual std::string ToString() const override {
@@ -730,24 +972,16 @@ namespace Construction {
                 // Prepare result
                 Scalar result = 0;
 
-                // Get all the contracted index combinations
-                auto contractedArgs = contracted.GetAllIndexCombinations();
-                bool containsContractions = contractedArgs.size() > 0;
-
-                // If the tensor does not contain contractions
-                if (!containsContractions) contractedArgs.push_back({0});
-
-                // Merge with the given args
-                for (auto& args_ : contractedArgs) {
+                // Merge all the contracted index combinations with the given args.
+                // Without contractions there is exactly one (empty) combination.
+                for (auto& args_ : contracted.GetIndexCombinations()) {
                     IndexAssignments assignment1;
                     IndexAssignments assignment2;
 
                     // Set the value of the contracted indices
-                    if (containsContractions) {
-                        for (unsigned i=0; i<contracted.Size(); ++i) {
-                            assignment1[contracted[i].GetName()] = args_[i];
-                            assignment2[contracted[i].GetName()] = args_[i];
-                        }
+                    for (unsigned i=0; i<contracted.Size(); ++i) {
+                        assignment1[contracted[i].GetName()] = args_[i];
+                        assignment2[contracted[i].GetName()] = args_[i];
                     }
 
                     // Set the values of the rest
@@ -776,12 +1010,115 @@ namespace Construction {
 
 				return result;
 			}
+
+			/**
+				\brief Evaluates the product on a list of index combinations
+
+				Evaluates the product on a list of index combinations. Both
+				factors are evaluated only once on all their components. Every
+				component of the product is then given by contracting the two
+				arrays, where the positions in the arrays are calculated from
+				the strides of the indices.
+			 */
+			virtual std::vector<Scalar> EvaluateColumn(const IndexCombinationTable& combinations) const override {
+				auto indicesA = A->GetIndices();
+				auto indicesB = B->GetIndices();
+
+				// Find contracted indices of both factors. The strides only work if every
+				// index appears once per factor and every contracted index in both factors,
+				// otherwise fall back to the evaluation component by component.
+				Indices contracted;
+				for (auto& factor : { indicesA, indicesB }) {
+					for (unsigned k=0; k<factor.Size(); ++k) {
+						if (factor.IndexOf(factor[k]) != static_cast<int>(k)) {
+							return AbstractTensor::EvaluateColumn(combinations);
+						}
+
+						if (!indices.ContainsIndex(factor[k]) && !contracted.ContainsIndex(factor[k])) {
+							contracted.Insert(factor[k]);
+						}
+					}
+				}
+
+				for (auto& index : contracted) {
+					if (!indicesA.ContainsIndex(index) || !indicesB.ContainsIndex(index)) {
+						return AbstractTensor::EvaluateColumn(combinations);
+					}
+				}
+
+				// Evaluate both factors on all of their components
+				auto componentsA = A->EvaluateAll();
+				auto componentsB = B->EvaluateAll();
+
+				std::vector<bool> nonZeroA (componentsA.size());
+				for (unsigned i=0; i<componentsA.size(); ++i) {
+					nonZeroA[i] = !componentsA[i].IsNumeric() || componentsA[i].ToDouble() != 0;
+				}
+
+				// Helper to determine the strides of the free and the contracted indices
+				auto strides = [&](const Indices& factor, std::vector<std::pair<unsigned,unsigned>>& free, std::vector<std::pair<unsigned,unsigned>>& summed) {
+					unsigned stride = 1;
+					for (int k=factor.Size()-1; k>=0; --k) {
+						int pos = indices.IndexOf(factor[k]);
+
+						if (pos >= 0) {
+							free.push_back({ pos, stride });
+						} else {
+							summed.push_back({ static_cast<unsigned>(contracted.IndexOf(factor[k])), stride });
+						}
+
+						stride *= factor[k].GetRange().GetDimension();
+					}
+				};
+
+				std::vector<std::pair<unsigned,unsigned>> freeA, summedA, freeB, summedB;
+				strides(indicesA, freeA, summedA);
+				strides(indicesB, freeB, summedB);
+
+				// Calculate the offsets of all the contracted index combinations
+				auto contractedArgs = contracted.GetIndexCombinations();
+				std::vector<std::pair<unsigned,unsigned>> offsets;
+				offsets.reserve(contractedArgs.Size());
+
+				for (auto& args : contractedArgs) {
+					unsigned offsetA = 0, offsetB = 0;
+					for (auto& pair : summedA) offsetA += (args[pair.first] - contracted[pair.first].GetRange().GetFrom()) * pair.second;
+					for (auto& pair : summedB) offsetB += (args[pair.first] - contracted[pair.first].GetRange().GetFrom()) * pair.second;
+					offsets.push_back({ offsetA, offsetB });
+				}
+
+				// Contract the arrays
+				std::vector<Scalar> result;
+				result.reserve(combinations.Size());
+
+				if (combinations.GetRank() != indices.Size()) {
+					throw IncompleteIndexAssignmentException();
+				}
+
+				for (size_t j=0; j<combinations.Size(); ++j) {
+					auto combination = combinations[j];
+
+					unsigned baseA = 0, baseB = 0;
+					for (auto& pair : freeA) baseA += (combination[pair.first] - indices[pair.first].GetRange().GetFrom()) * pair.second;
+					for (auto& pair : freeB) baseB += (combination[pair.first] - indices[pair.first].GetRange().GetFrom()) * pair.second;
+
+					Scalar value = 0;
+					for (auto& offset : offsets) {
+						if (!nonZeroA[baseA + offset.first]) continue;
+						value += componentsA[baseA + offset.first] * componentsB[baseB + offset.second];
+					}
+
+					result.push_back(value);
+				}
+
+				return result;
+			}
 		public:
-			const TensorPointer& GetFirst() const {
+			const ConstTensorPointer& GetFirst() const {
 				return A;
 			}
 
-			const TensorPointer& GetSecond() const {
+			const ConstTensorPointer& GetSecond() const {
 				return B;
 			}
 		public:
@@ -800,17 +1137,48 @@ namespace Construction {
                 return TensorPointer(new MultipliedTensor(std::move(A->Canonicalize()), std::move(B->Canonicalize())));
             }
 
+            /**
+                \brief Push a contraction down to the factor that carries the index
+
+                Push a contraction down to the factor that shares the index
+                with the other tensor, such that e.g. the gamma in
+                \gamma^{mn}X_{ab} \epsilon_{mcd} can still be contracted
+                with the epsilon. The result is multiplied again with the
+                remaining factor, which allows follow-up contractions.
+             */
+            virtual std::unique_ptr<AbstractTensor> ContractionHeuristics(const AbstractTensor& other) const override {
+                for (int i=0; i<2; i++) {
+                    auto& factor = (i == 0) ? A : B;
+                    auto& rest = (i == 0) ? B : A;
+
+                    bool shared = false;
+                    for (auto& index : factor->GetIndices()) {
+                        if (other.GetIndices().ContainsIndex(index)) {
+                            shared = true;
+                            break;
+                        }
+                    }
+                    if (!shared) continue;
+
+                    auto heuristics = factor->ContractionHeuristics(other);
+                    if (heuristics == nullptr) heuristics = other.ContractionHeuristics(*factor);
+                    if (heuristics != nullptr) return Multiply(*heuristics, *rest);
+                }
+
+                return nullptr;
+            }
+
             virtual std::unique_ptr<AbstractTensor> MultiplicationHeuristics(const AbstractTensor& other) const override {
                 // Try to apply heuristics to first one
                 auto heuristics = A->MultiplicationHeuristics(other);
                 if (heuristics) {
-                    return TensorPointer(new MultipliedTensor(std::move(heuristics), std::move(B->Clone())));
+                    return TensorPointer(new MultipliedTensor(std::move(heuristics), B));
                 }
 
                 // Try to apply heuristics to the second one
                 heuristics = B->MultiplicationHeuristics(other);
                 if (heuristics) {
-                    return TensorPointer(new MultipliedTensor(std::move(A->Clone()), std::move(heuristics)));
+                    return TensorPointer(new MultipliedTensor(A, std::move(heuristics)));
                 }
 
                 return nullptr;
@@ -822,9 +1190,18 @@ namespace Construction {
                 bool b = *static_cast<const MultipliedTensor&>(other).A == *B && *static_cast<const MultipliedTensor&>(other).B == *A;
                 return a || b;
             }
+
+            virtual size_t Hash() const override {
+                return HashCombine(HashCombine(static_cast<size_t>(type), A->Hash()), B->Hash());
+            }
+
+            virtual bool IsIdentical(const AbstractTensor& other) const override {
+                if (!other.IsMultipliedTensor()) return false;
+                return A->IsIdentical(*static_cast<const MultipliedTensor&>(other).A) && B->IsIdentical(*static_cast<const MultipliedTensor&>(other).B);
+            }
 		private:
-			TensorPointer A;
-			TensorPointer B;
+			ConstTensorPointer A;
+			ConstTensorPointer B;
 		};
 
 		/**
@@ -848,7 +1225,7 @@ namespace Construction {
 		public:
 			virtual TensorPointer Clone() const override {
 				return TensorPointer(new ScaledTensor(
-					std::move(A->Clone()),
+					ConstTensorPointer(A),
 					c
 				));
 			}
@@ -867,6 +1244,14 @@ namespace Construction {
                 return A->Evaluate(args) * c;
 			}
 
+			virtual std::vector<Scalar> EvaluateColumn(const IndexCombinationTable& combinations) const override {
+				auto result = A->EvaluateColumn(combinations);
+				for (auto& value : result) {
+					value = value * c;
+				}
+				return result;
+			}
+
 			virtual TensorPointer Canonicalize() const override {
 				auto newA = A->Canonicalize();
 				if (newA->IsScaledTensor()) {
@@ -915,6 +1300,15 @@ namespace Construction {
                 if (!other.IsScaledTensor()) return false;
                 return *static_cast<const ScaledTensor&>(other).A == *A && static_cast<const ScaledTensor&>(other).c == c;
             }
+
+            virtual size_t Hash() const override {
+                return HashCombine(HashCombine(static_cast<size_t>(type), A->Hash()), AbstractTensor::Hash(c));
+            }
+
+            virtual bool IsIdentical(const AbstractTensor& other) const override {
+                if (!other.IsScaledTensor()) return false;
+                return static_cast<const ScaledTensor&>(other).c == c && A->IsIdentical(*static_cast<const ScaledTensor&>(other).A);
+            }
         public:
 			virtual void SetIndices(const Indices& newIndices) override {
 				indices = newIndices;
@@ -1051,7 +1445,7 @@ namespace Construction {
 		 */
 		class SubstituteTensor : public AbstractTensor {
 		public:
-			SubstituteTensor(TensorPointer A, const Indices& indices) : AbstractTensor("", "", indices), A(std::move(A)) {
+			SubstituteTensor(ConstTensorPointer A, const Indices& indices) : AbstractTensor("", "", indices), A(std::move(A)) {
 				type = TensorType::SUBSTITUTE;
 
 				if (!indices.IsPermutationOf(this->A->GetIndices())) {
@@ -1062,7 +1456,7 @@ namespace Construction {
 			virtual ~SubstituteTensor() = default;
 		public:
 			virtual TensorPointer Clone() const override {
-				return TensorPointer(new SubstituteTensor(std::move(A->Clone()), indices));
+				return TensorPointer(new SubstituteTensor(A, indices));
 			}
 		public:
 			bool IsAddedTensor() const {
@@ -1079,6 +1473,15 @@ namespace Construction {
 
                 return *one == other;
             }
+
+            virtual size_t Hash() const override {
+                return HashCombine(AbstractTensor::Hash(), A->Hash());
+            }
+
+            virtual bool IsIdentical(const AbstractTensor& other) const override {
+                if (!other.IsSubstitute()) return false;
+                return AbstractTensor::IsIdentical(other) && A->IsIdentical(*static_cast<const SubstituteTensor&>(other).A);
+            }
 		public:
 			virtual std::string ToString() const override {
 				return A->ToString();
@@ -1099,11 +1502,23 @@ namespace Construction {
 				return (*A)(assignment);
 			}
 
+			/**
+				\brief Evaluates the tensor on a list of index combinations
+
+				Since the substitution only changes the index structure, we just
+				rearrange the combinations into the index order of the
+				substituted tensor.
+			 */
+			virtual std::vector<Scalar> EvaluateColumn(const IndexCombinationTable& combinations) const override {
+				IndexCombinationTable reordered;
+				return A->EvaluateColumn(ReorderCombinations(indices, A->GetIndices(), combinations, reordered));
+			}
+
             virtual TensorPointer Canonicalize() const override {
                 return TensorPointer(new SubstituteTensor(std::move(A->Canonicalize()), indices));
             }
 		public:
-			const TensorPointer& GetTensor() const {
+			const ConstTensorPointer& GetTensor() const {
 				return A;
 			}
 		public:
@@ -1115,7 +1530,11 @@ namespace Construction {
 				auto permutationA = Permutation::From(indices, A->GetIndices());
 
 				indices = newIndices;
-				A->SetIndices(permutationA(newIndices));
+
+				// A might be shared, so relabel a copy of it
+				auto newA = A->Clone();
+				newA->SetIndices(permutationA(newIndices));
+				A = std::move(newA);
 			}
 
 			/**
@@ -1134,7 +1553,7 @@ namespace Construction {
 				return TensorPointer(new SubstituteTensor(std::move(A), indices));
 			}
 		private:
-			TensorPointer A;
+			ConstTensorPointer A;
 		};
 
 		/**
@@ -1176,6 +1595,14 @@ namespace Construction {
                 if (!other.IsScalar()) return false;
                 return static_cast<const ScalarTensor&>(other).value == value;
             }
+
+            virtual size_t Hash() const override {
+                return HashCombine(static_cast<size_t>(type), AbstractTensor::Hash(value));
+            }
+
+            virtual bool IsIdentical(const AbstractTensor& other) const override {
+                return *this == other;
+            }
         public:
 			virtual Scalar Evaluate(const std::vector<unsigned>& args) const override {
 				return value;
@@ -1209,13 +1636,17 @@ namespace Construction {
 		}
 
 		std::unique_ptr<AbstractTensor> AbstractTensor::Add(const AbstractTensor& one, const AbstractTensor& other) {
-			// Clone the tensors
-			auto first = one.Clone();
-			auto second = other.Clone();
+			// If one is the zero tensor
+			if (one.IsZeroTensor()) return other.Clone();
+			if (other.IsZeroTensor()) return one.Clone();
+
+			return Add(one.Clone(), other.Clone());
+		}
 
+		std::unique_ptr<AbstractTensor> AbstractTensor::Add(std::unique_ptr<AbstractTensor> first, std::unique_ptr<AbstractTensor> second) {
 			// If one is the zero tensor
-			if (one.IsZeroTensor()) return std::move(second);
-			if (other.IsZeroTensor()) return std::move(first);
+			if (first->IsZeroTensor()) return std::move(second);
+			if (second->IsZeroTensor()) return std::move(first);
 
 			// If the first one is an added tensor and the second isn't, simply add the new one to the other
 			// and return the original pointer to keep memory allocation low
@@ -1224,21 +1655,16 @@ namespace Construction {
 				return std::move(first);
 			}
 
-			// If the second one is an added tensor and the second isn't, simply add the new one to the other
+			// If the second one is an added tensor and the first isn't, simply add the new one to the other
 			// and return the original pointer to keep memory allocation low
-			if (second->IsAddedTensor() && !second->IsAddedTensor()) {
-				static_cast<AddedTensor*>(first.get())->AddFromLeft(std::move(first));
+			if (second->IsAddedTensor() && !first->IsAddedTensor()) {
+				static_cast<AddedTensor*>(second.get())->AddFromLeft(std::move(first));
 				return std::move(second);
 			}
 
 			// If both are added tensors, move all the content from the right one into the left
 			if (first->IsAddedTensor() && second->IsAddedTensor()) {
-				AddedTensor* _second = static_cast<AddedTensor*>(second.get());
-
-				for (int i=0; i<_second->Size(); i++) {
-					static_cast<AddedTensor*>(first.get())->AddFromRight(std::move(_second->At(i)->Clone()));
-				}
-
+				static_cast<AddedTensor*>(first.get())->AddFromRight(std::move(*static_cast<AddedTensor*>(second.get())));
 				return std::move(first);
 			}
 
@@ -1281,30 +1707,30 @@ namespace Construction {
 
             // If one of the tensors is scalar
             if (one.IsScalar()) {
-                auto value = static_cast<ScalarTensor*>(one.Clone().get())->GetValue();
+                auto value = static_cast<const ScalarTensor&>(one).GetValue();
                 return std::move(Multiply(second, value));
             }
 
             if (second.IsScalar()) {
-                auto value = static_cast<ScalarTensor*>(second.Clone().get())->GetValue();
+                auto value = static_cast<const ScalarTensor&>(second).GetValue();
                 return std::move(Multiply(one, value));
             }
 
 			// Do some magic if we multiply scaled tensors
 			if (one.IsScaledTensor() && !second.IsScaledTensor()) {
 				auto s = static_cast<const ScaledTensor*>(&one)->GetScale();
-				auto tensor = static_cast<const ScaledTensor*>(&one)->GetTensor()->Clone();
+				auto& tensor = static_cast<const ScaledTensor*>(&one)->GetTensor();
 
 				return std::move(Multiply(*Multiply(*tensor, second), s));
 			} else if (!one.IsScaledTensor() && second.IsScaledTensor()) {
 				auto s = static_cast<const ScaledTensor*>(&second)->GetScale();
-				auto tensor = static_cast<const ScaledTensor*>(&second)->GetTensor()->Clone();
+				auto& tensor = static_cast<const ScaledTensor*>(&second)->GetTensor();
 
 				return std::move(Multiply(*Multiply(one, *tensor), s));
 			} else if (one.IsScaledTensor() && second.IsScaledTensor()) {
 				auto s = static_cast<const ScaledTensor*>(&one)->GetScale() * static_cast<const ScaledTensor*>(&second)->GetScale();
-				auto tensorA = static_cast<const ScaledTensor*>(&one)->GetTensor()->Clone();
-				auto tensorB = static_cast<const ScaledTensor*>(&second)->GetTensor()->Clone();
+				auto& tensorA = static_cast<const ScaledTensor*>(&one)->GetTensor();
+				auto& tensorB = static_cast<const ScaledTensor*>(&second)->GetTensor();
 
 				return std::move(Multiply(*Multiply(*tensorA, *tensorB), s));
 			}
@@ -1335,9 +1761,9 @@ namespace Construction {
 
 			// Syntactic sugar for scaling a scaled tensor
 			if (one.IsScaledTensor()) {
-				ScaledTensor* tensor = static_cast<ScaledTensor*>(clone.get());
+				const ScaledTensor* tensor = static_cast<const ScaledTensor*>(&one);
 				return TensorPointer(new ScaledTensor(
-					std::move(tensor->GetTensor()->Clone()),
+					ConstTensorPointer(tensor->GetTensor()),
 					tensor->GetScale() * c
 				));
 			}
@@ -1345,7 +1771,7 @@ namespace Construction {
 			// Syntactic sugar for scaling a substitute tensor
 			if (one.IsSubstitute()) {
 				return TensorPointer(new SubstituteTensor(
-					std::move(Multiply(*static_cast<SubstituteTensor*>(one.Clone().get())->GetTensor(), c)),
+					std::move(Multiply(*static_cast<const SubstituteTensor*>(&one)->GetTensor(), c)),
 					one.GetIndices()
 				));
 			}
@@ -1410,6 +1836,14 @@ namespace Construction {
                 try {
                     auto otherIndices = other.GetIndices();
 
+                    // If both indices are contracted, renaming would leave a trace
+                    // on the other tensor. Only the trace \delta^a_b \delta^b_a = n is
+                    // known, everything else is left to the numerical evaluation.
+                    if (otherIndices.ContainsIndex(indices[0]) && otherIndices.ContainsIndex(indices[1])) {
+                        if (!other.IsDeltaTensor()) return nullptr;
+                        return TensorPointer(new ScalarTensor(Scalar(static_cast<int>(indices[0].GetRange().GetDimension()))));
+                    }
+
                     // Make mapping
                     std::map<Index, Index> mapping;
                     for (auto& index : otherIndices) {
@@ -1546,6 +1980,84 @@ namespace Construction {
 				}
 			}
 
+			/**
+				\brief Contract two Levi-Civita symbols
+
+				Contract two Levi-Civita symbols by the determinant of
+				Kronecker deltas. With k contracted indices in n dimensions
+				this reads
+
+				\epsilon_{s_1...s_k a_1...a_m} \epsilon^{s_1...s_k b_1...b_m} = k! \delta^{[b_1}_{a_1} ... \delta^{b_m]}_{a_m}
+
+				with the antisymmetrization in terms of the m! permutations
+				(without normalization). The contracted indices are moved
+				to the front of both symbols first, which is accounted for
+				by the sign of the permutations.
+			 */
+			virtual TensorPointer ContractionHeuristics(const AbstractTensor& other) const override {
+				if (!other.IsEpsilonTensor()) return nullptr;
+
+				auto otherIndices = other.GetIndices();
+				if (otherIndices.Size() != indices.Size()) return nullptr;
+
+				// Split into contracted and free indices
+				Indices shared, freeA, freeB;
+				for (auto& index : indices) {
+					if (otherIndices.ContainsIndex(index)) shared.Insert(index);
+					else freeA.Insert(index);
+				}
+				for (auto& index : otherIndices) {
+					if (!indices.ContainsIndex(index)) freeB.Insert(index);
+				}
+
+				// Sign of moving the contracted indices to the front
+				Indices orderedA = shared;
+				orderedA.Append(freeA);
+				Indices orderedB = shared;
+				orderedB.Append(freeB);
+
+				int sign = Permutation::From(indices, orderedA).Sign() * Permutation::From(otherIndices, orderedB).Sign();
+
+				int factor = sign;
+				for (unsigned i=2; i<=shared.Size(); i++) factor *= i;
+
+				// Fully contracted
+				if (freeA.Size() == 0) {
+					return TensorPointer(new ScalarTensor(Scalar(factor)));
+				}
+
+				// Sum over all permutations of the free indices of the second symbol
+				std::vector<unsigned> permutation;
+				for (unsigned i=0; i<freeB.Size(); i++) permutation.push_back(i);
+
+				TensorPointer result (new ZeroTensor());
+
+				do {
+					// Sign of the permutation by counting inversions
+					int permutationSign = factor;
+					for (unsigned i=0; i<permutation.size(); i++) {
+						for (unsigned j=i+1; j<permutation.size(); j++) {
+							if (permutation[i] > permutation[j]) permutationSign = -permutationSign;
+						}
+					}
+
+					TensorPointer summand;
+					for (unsigned i=0; i<freeA.Size(); i++) {
+						auto& a = freeA[i];
+						auto& b = freeB[permutation[i]];
+
+						TensorPointer delta (new DeltaTensor(b.IsContravariant() && !a.IsContravariant() ? Indices({ b, a }) : Indices({ a, b })));
+
+						if (summand == nullptr) summand = std::move(delta);
+						else summand = Multiply(*summand, *delta);
+					}
+
+					result = Add(std::move(result), Multiply(*summand, Scalar(permutationSign)));
+				} while (std::next_permutation(permutation.begin(), permutation.end()));
+
+				return std::move(result);
+			}
+
 			/**
 				Returns the Levi-Civita symbol in 3+1 dim spacetime, where
 			 	the zeroth index is in temporal direction.
@@ -1608,6 +2120,10 @@ namespace Construction {
                 if (!other.IsGammaTensor()) return false;
                 return indices == other.GetIndices();
             }
+
+            virtual bool IsIdentical(const AbstractTensor& other) const override {
+                return AbstractTensor::IsIdentical(other) && static_cast<const GammaTensor&>(other).signature == signature;
+            }
 		public:
 			std::pair<int, int> GetSignature() const { return signature; }
 			void SetSignature(int p, int q) { signature = {p,q}; }
@@ -1653,19 +2169,67 @@ namespace Construction {
 				auto sortedIndices = indices.Ordered();
 				return std::move(TensorPointer(new GammaTensor(sortedIndices, signature.first, signature.second)));
 			}
-		public:
-			static void DoSerialize(std::ostream& os, const GammaTensor& tensor) {
-				int p = tensor.signature.first;
-				int q = tensor.signature.second;
 
-				os.write(reinterpret_cast<const char*>(&p), sizeof(p));
-				os.write(reinterpret_cast<const char*>(&q), sizeof(q));
-			}
+			/**
+				\brief Heuristics for contractions with the metric
+
+				Contracting two metrics yields \gamma^{ab}\gamma_{bc} = \delta^a_c
+				and the trace \gamma^{ab}\gamma_{ab} = n, since the components
+				are \pm 1 on the diagonal. For a Euclidean signature
+				raising and lowering an index of the Levi-Civita symbol
+				does not change its components, so the contracted index
+				is simply renamed.
+			 */
+			virtual TensorPointer ContractionHeuristics(const AbstractTensor& other) const override {
+				auto otherIndices = other.GetIndices();
 
-			static TensorPointer DoDeserialize(std::istream& is, const Indices& indices) {
-				int p, q;
-				is.read(reinterpret_cast<char*>(&p), sizeof(p));
-				is.read(reinterpret_cast<char*>(&q), sizeof(q));
+				bool first = otherIndices.ContainsIndex(indices[0]);
+				bool second = otherIndices.ContainsIndex(indices[1]);
+
+				if (first == second) {
+					if (!first || !other.IsGammaTensor()) return nullptr;
+					return TensorPointer(new ScalarTensor(Scalar(static_cast<int>(indices[0].GetRange().GetDimension()))));
+				}
+
+				auto contracted = first ? indices[0] : indices[1];
+				auto remaining = first ? indices[1] : indices[0];
+
+				if (other.IsGammaTensor()) {
+					auto& otherRemaining = otherIndices[0] == contracted ? otherIndices[1] : otherIndices[0];
+
+					if (otherRemaining.IsContravariant() && !remaining.IsContravariant()) {
+						return TensorPointer(new DeltaTensor({ otherRemaining, remaining }));
+					}
+					return TensorPointer(new DeltaTensor({ remaining, otherRemaining }));
+				}
+
+				if (other.IsEpsilonTensor() && signature.first == 0) {
+					std::map<Index, Index> mapping;
+					for (auto& index : otherIndices) {
+						mapping[index] = index;
+					}
+					mapping[contracted] = remaining;
+
+					auto clone = other.Clone();
+					clone->SetIndices(otherIndices.Shuffle(mapping));
+					return std::move(clone);
+				}
+
+				return nullptr;
+			}
+		public:
+			static void DoSerialize(std::ostream& os, const GammaTensor& tensor) {
+				int p = tensor.signature.first;
+				int q = tensor.signature.second;
+
+				os.write(reinterpret_cast<const char*>(&p), sizeof(p));
+				os.write(reinterpret_cast<const char*>(&q), sizeof(q));
+			}
+
+			static TensorPointer DoDeserialize(std::istream& is, const Indices& indices) {
+				int p, q;
+				is.read(reinterpret_cast<char*>(&p), sizeof(p));
+				is.read(reinterpret_cast<char*>(&q), sizeof(q));
 
 				return TensorPointer(new GammaTensor(indices, p, q));
 			}
@@ -1792,6 +2356,15 @@ namespace Construction {
                 if (!other.IsEpsilonGammaTensor()) return false;
                 return indices == other.GetIndices();
             }
+
+            virtual size_t Hash() const override {
+                return HashCombine(HashCombine(AbstractTensor::Hash(), numEpsilon), numGamma);
+            }
+
+            virtual bool IsIdentical(const AbstractTensor& other) const override {
+                if (!AbstractTensor::IsIdentical(other)) return false;
+                return static_cast<const EpsilonGammaTensor&>(other).numEpsilon == numEpsilon && static_cast<const EpsilonGammaTensor&>(other).numGamma == numGamma;
+            }
 		public:
 			unsigned GetNumEpsilons() const { return numEpsilon; }
 			unsigned GetNumGammas() const { return numGamma; }
@@ -1838,49 +2411,142 @@ namespace Construction {
 				this->indices = indices;
 			}
 
+			/**
+				\brief Canonicalize the epsilon-gamma tensor
+
+				Brings the tensor into a unique canonical form, even if it
+				contains contracted (dummy) indices. This is the minimal
+				representative of the double coset of the slot symmetries, i.e.
+				the (anti-)symmetry of the epsilons and gammas and their
+				commutativity, and the relabelling of the dummy indices.
+
+				The slot symmetries are resolved by sorting, so only the
+				relabellings of the dummies, i.e. their permutations and the
+				exchange of the upper and lower index in every pair, need to
+				be enumerated. If the minimal form is reached with both signs,
+				the tensor vanishes.
+
+				The dummies are renamed to the first free indices of their kind,
+				i.e. Roman or Greek, and only names of the same kind are exchanged.
+				Since this enumerates up to d!*2^d relabellings for d dummies, the
+				relabelling is skipped for more than six dummies. Then only the
+				slot symmetries are resolved and the form depends on the names.
+			 */
 			virtual TensorPointer Canonicalize() const override {
-				unsigned pos = 0;
+				std::vector<Index> slots (indices.begin(), indices.end());
+
+				// Find the dummy indices, i.e. the ones that occur twice
+				std::vector<Index> dummies;
+				unsigned flippable = 0;
+
+				for (unsigned i=0; i<slots.size(); ++i) {
+					for (unsigned j=i+1; j<slots.size(); ++j) {
+						if (slots[i] != slots[j]) continue;
+
+						if (std::find(dummies.begin(), dummies.end(), slots[i]) == dummies.end()) {
+							// Only pairs of an upper and a lower index can be exchanged
+							if (slots[i].IsContravariant() != slots[j].IsContravariant()) {
+								flippable |= (1u << dummies.size());
+							}
+
+							dummies.push_back(slots[i]);
+						}
+					}
+				}
+
 				int sign = 1;
 
-				Indices newIndices;
+				if (dummies.size() == 0 || dummies.size() > 6) {
+					if (!SortSlots(slots, sign)) return TensorPointer(new ZeroTensor());
+				} else {
+					// Rename the dummies to the first indices of their kind that are
+					// not taken by a free index, s.t. the names do not matter. Only the
+					// names are taken from the pool, every dummy keeps its own range.
+					std::vector<Index> free;
+					for (auto& slot : slots) {
+						if (std::find(dummies.begin(), dummies.end(), slot) == dummies.end()) free.push_back(slot);
+					}
 
-				// Canonicalize the epsilon contribution
-				if (numEpsilon == 1) {
-					auto epsilonIndices = indices.Partial({0, 2});
+					auto unusedOf = [&](const Indices& pool, int k) {
+						unsigned count = std::count_if(dummies.begin(), dummies.end(), [&](const Index& index) { return SlotKind(index) == k; });
 
-					// Sort and append the indices to the new list
-					auto sortedIndices = epsilonIndices.Ordered();
-					newIndices.Append(sortedIndices);
+						std::vector<Index> unused;
+						for (auto& index : pool) {
+							if (unused.size() == count) break;
+							if (std::find(free.begin(), free.end(), index) == free.end()) unused.push_back(index);
+						}
 
-					// Find the sign
-					sign = Permutation::From(epsilonIndices, sortedIndices).Sign();
+						return unused.size() == count ? unused : std::vector<Index>();
+					};
 
-					pos += 3;
-				}
+					auto roman = unusedOf(Indices::GetRomanSeries(52, dummies[0].GetRange()), 0);
+					auto greek = unusedOf(Indices::GetGreekSeries(GreekIndices.size(), dummies[0].GetRange()), 1);
 
-				// Vector for the sorted indices of the gammas
-				std::vector<Indices> gammas;
+					auto names = dummies;
+					unsigned numRoman = 0, numGreek = 0;
 
-				// Canonicalize the gamma contribution
-				for (unsigned i=0; i<numGamma; i++) {
-					auto gammaIndices = indices.Partial({pos, pos+1});
+					for (auto& name : names) {
+						if (SlotKind(name) == 0 && numRoman < roman.size()) name = roman[numRoman++];
+						else if (SlotKind(name) == 1 && numGreek < greek.size()) name = greek[numGreek++];
+					}
 
-					// Sort and append the indices to the new list
-					auto sortedIndices = gammaIndices.Ordered();
-					gammas.push_back(sortedIndices);
+					// Canonicalize all the relabellings of the dummies
+					std::vector<std::pair<std::vector<Index>, int>> candidates;
 
-					pos += 2;
-				}
+					std::vector<unsigned> order (dummies.size());
+					for (unsigned i=0; i<order.size(); ++i) order[i] = i;
 
-				// Sort the indices of the gammas to respect the
-				// commutivity of gammas
-				std::sort(gammas.begin(), gammas.end(), [](const Indices& a, const Indices& b) {
-					return a[0] < b[0];
-				});
+					do {
+						// Only exchange names of the same kind
+						bool sameKind = true;
+						for (unsigned k=0; k<order.size(); ++k) {
+							if (SlotKind(names[order[k]]) != SlotKind(names[k])) sameKind = false;
+						}
+
+						if (!sameKind) continue;
+
+						for (unsigned flips=0; flips < (1u << dummies.size()); ++flips) {
+							if ((flips & flippable) != flips) continue;
+
+							auto relabelled = slots;
+
+							for (auto& slot : relabelled) {
+								auto it = std::find(dummies.begin(), dummies.end(), slot);
+								if (it == dummies.end()) continue;
+
+								unsigned k = it - dummies.begin();
+								bool up = slot.IsContravariant();
+
+								auto& name = names[order[k]];
+								slot = Index(name.GetName(), name.GetPrintedText(), slot.GetRange());
+								slot.SetContravariant(((flips >> k) & 1) ? !up : up);
+							}
+
+							int candidateSign;
+							if (!SortSlots(relabelled, candidateSign)) return TensorPointer(new ZeroTensor());
+
+							candidates.push_back({ std::move(relabelled), candidateSign });
+						}
+					} while (std::next_permutation(order.begin(), order.end()));
 
-				// Append the now sorted gammas to all indices
-				for (auto& gammaIndices : gammas) {
-					newIndices.Append(gammaIndices);
+					auto best = std::min_element(candidates.begin(), candidates.end(), [](const std::pair<std::vector<Index>, int>& a, const std::pair<std::vector<Index>, int>& b) {
+						return SlotsLess(a.first, b.first);
+					});
+
+					// If the minimal form occurs with both signs, the tensor vanishes
+					for (auto& candidate : candidates) {
+						if (candidate.second != best->second && SlotsEqual(candidate.first, best->first)) {
+							return TensorPointer(new ZeroTensor());
+						}
+					}
+
+					slots = best->first;
+					sign = best->second;
+				}
+
+				Indices newIndices;
+				for (auto& slot : slots) {
+					newIndices.Insert(slot);
 				}
 
 				// Construct and return result
@@ -1890,6 +2556,89 @@ namespace Construction {
 					return std::move(TensorPointer(new EpsilonGammaTensor(numEpsilon, numGamma, newIndices)));
 				}
 			}
+		private:
+			/**
+				Returns the kind of an index, i.e. 0 for Roman, 1 for Greek and 2
+				for all the other indices
+			 */
+			static int SlotKind(const Index& index) {
+				return index.IsRomanIndex() ? 0 : (index.IsGreekIndex() ? 1 : 2);
+			}
+
+			/**
+				Orders two slots by the kind and the name of their index and puts
+				the lower index first if the names agree
+			 */
+			static bool SlotLess(const Index& a, const Index& b) {
+				if (SlotKind(a) != SlotKind(b)) return SlotKind(a) < SlotKind(b);
+				if (a < b) return true;
+				if (b < a) return false;
+				return !a.IsContravariant() && b.IsContravariant();
+			}
+
+			static bool SlotsLess(const std::vector<Index>& a, const std::vector<Index>& b) {
+				return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), SlotLess);
+			}
+
+			static bool SlotsEqual(const std::vector<Index>& a, const std::vector<Index>& b) {
+				return std::equal(a.begin(), a.end(), b.begin(), [](const Index& x, const Index& y) {
+					return x == y && x.IsContravariant() == y.IsContravariant();
+				});
+			}
+
+			/**
+				\brief Sorts the slots into the canonical order
+
+				Sorts the indices inside of every epsilon and gamma and then
+				the epsilons and the gammas among each other. The sign of the
+				permutations of the epsilon indices is returned in `sign`.
+
+				\returns false if an epsilon carries an index twice and vanishes
+			 */
+			bool SortSlots(std::vector<Index>& slots, int& sign) const {
+				std::vector<std::vector<Index>> epsilons;
+				std::vector<std::vector<Index>> gammas;
+
+				unsigned pos = 0;
+				sign = 1;
+
+				for (unsigned i=0; i<numEpsilon; i++) {
+					std::vector<Index> epsilon (slots.begin() + pos, slots.begin() + pos + 3);
+
+					// Sort by exchanging neighbours to keep track of the sign
+					for (unsigned j=0; j<2; j++) {
+						for (unsigned k=0; k<2-j; k++) {
+							if (SlotLess(epsilon[k+1], epsilon[k])) {
+								std::swap(epsilon[k], epsilon[k+1]);
+								sign = -sign;
+							}
+						}
+					}
+
+					if (epsilon[0] == epsilon[1] || epsilon[1] == epsilon[2]) return false;
+
+					epsilons.push_back(std::move(epsilon));
+					pos += 3;
+				}
+
+				for (unsigned i=0; i<numGamma; i++) {
+					std::vector<Index> gamma (slots.begin() + pos, slots.begin() + pos + 2);
+					if (SlotLess(gamma[1], gamma[0])) std::swap(gamma[0], gamma[1]);
+
+					gammas.push_back(std::move(gamma));
+					pos += 2;
+				}
+
+				// Sort the epsilons and gammas to respect their commutativity
+				std::sort(epsilons.begin(), epsilons.end(), SlotsLess);
+				std::sort(gammas.begin(), gammas.end(), SlotsLess);
+
+				slots.clear();
+				for (auto& epsilon : epsilons) slots.insert(slots.end(), epsilon.begin(), epsilon.end());
+				for (auto& gamma : gammas) slots.insert(slots.end(), gamma.begin(), gamma.end());
+
+				return true;
+			}
 		public:
 			static void DoSerialize(std::ostream& os, const EpsilonGammaTensor& tensor) {
 				unsigned numEpsilon = tensor.numEpsilon;
@@ -2034,15 +2783,30 @@ namespace Construction {
 			Tensor() : pointer(TensorPointer(new ZeroTensor())) { }
 			Tensor(const std::string& name, const std::string& printable, const Indices& indices) : pointer(TensorPointer(new AbstractTensor(name, printable, indices))) { }
 
-			Tensor(const Tensor& other) : pointer(std::move(other.pointer->Clone())) { }
+			/**
+				Copy constructor. Since the nodes of a tensor are immutable, the
+				copy shares them and only detaches when it is modified.
+			 */
+			Tensor(const Tensor& other) : pointer(other.pointer) { }
 			Tensor(Tensor&& other) : pointer(std::move(other.pointer)) { }
 
 			virtual ~Tensor() = default;
 		private:
 			Tensor(TensorPointer pointer) : pointer(std::move(pointer)) { }
+			Tensor(const ConstTensorPointer& pointer) : pointer(std::const_pointer_cast<AbstractTensor>(pointer)) { }
+
+			/**
+				Make sure that the node is not shared with any other tensor
+				before it is modified in place
+			 */
+			void Detach() {
+				if (pointer.use_count() > 1) {
+					pointer = pointer->Clone();
+				}
+			}
 		public:
 			Tensor& operator=(const Tensor& other) {
-				pointer = std::move(other.pointer->Clone());
+				pointer = other.pointer;
 				return *this;
 			}
 
@@ -2051,13 +2815,8 @@ namespace Construction {
 				return *this;
 			}
 		public:
-			virtual ExpressionPointer Clone() const override { return std::move(ExpressionPointer(new Tensor(pointer->Clone()))); }
+			virtual ExpressionPointer Clone() const override { return std::move(ExpressionPointer(new Tensor(*this))); }
 		public:
-			template<class T>
-			T* As() {
-				return static_cast<T*>(pointer.get());
-			}
-
 			template<class T>
 			const T* As() const {
 				return static_cast<const T*>(pointer.get());
@@ -2102,7 +2861,7 @@ namespace Construction {
 					Tensor result = Tensor::Zero();
 
 					for (int i=0; i<tensor.As<AddedTensor>()->Size(); ++i) {
-						result += Substitute(Tensor(tensor.As<AddedTensor>()->At(i)->Clone()), indices);
+						result += Substitute(Tensor(tensor.As<AddedTensor>()->At(i)), indices);
 					}
 
 					return result;
@@ -2110,10 +2869,10 @@ namespace Construction {
 
 				// Syntactic sugar for scaling
 				if (tensor.IsScaled()) {
-					return tensor.As<ScaledTensor>()->GetScale() * Substitute(Tensor(tensor.As<ScaledTensor>()->GetTensor()->Clone()), indices);
+					return tensor.As<ScaledTensor>()->GetScale() * Substitute(Tensor(tensor.As<ScaledTensor>()->GetTensor()), indices);
 				}
 
-				return Tensor(TensorPointer(new SubstituteTensor(std::move(tensor.pointer->Clone()), indices)));
+				return Tensor(TensorPointer(new SubstituteTensor(tensor.pointer, indices)));
 			}
 		public:
 			bool IsCustom() const { return pointer->IsCustomTensor(); }
@@ -2136,13 +2895,15 @@ namespace Construction {
 			std::string TypeToString() const { return pointer->TypeToString(); }
 		public:
 			inline bool IsEqual(const Tensor& other) const { return pointer->IsEqual(*other.pointer); }
+			inline bool IsIdentical(const Tensor& other) const { return pointer->IsIdentical(*other.pointer); }
+			inline size_t Hash() const { return pointer->Hash(); }
 
 			inline Indices GetIndices() const { return pointer->GetIndices(); }
 			inline std::string GetName() const { return pointer->GetName(); }
-			inline void SetName(const std::string& name) { pointer->SetName(name); }
-			inline void SetIndices(const Indices& indices) { pointer->SetIndices(indices); }
+			inline void SetName(const std::string& name) { Detach(); pointer->SetName(name); }
+			inline void SetIndices(const Indices& indices) { Detach(); pointer->SetIndices(indices); }
 
-			inline void PermuteIndices(const Permutation& permutation) { pointer->PermuteIndices(permutation); }
+			inline void PermuteIndices(const Permutation& permutation) { Detach(); pointer->PermuteIndices(permutation); }
 
 			inline Tensor Canonicalize() const { return Tensor(std::move(pointer->Canonicalize())); }
 
@@ -2205,7 +2966,7 @@ namespace Construction {
 					std::vector<Tensor> result;
 
 					for (int i=0; i<As<AddedTensor>()->Size(); ++i) {
-						auto tensor = Tensor(std::move(As<AddedTensor>()->At(i)->Clone()));
+						auto tensor = Tensor(As<AddedTensor>()->At(i));
 						result.emplace_back(std::move(tensor));
 					}
 
@@ -2242,7 +3003,7 @@ namespace Construction {
 
 						for (auto& t : expanded) {
 							if (!t.IsZeroTensor()) {
-								tensors.push_back(t);
+								tensors.push_back(std::move(t));
 							}
 						}
 					}
@@ -2255,7 +3016,7 @@ namespace Construction {
 					std::vector<Tensor> tensors;
 
 					// Get the tensor that is scaled and expand it
-					auto tensor_summands = Tensor(std::move(static_cast<ScaledTensor*>(pointer.get())->GetTensor()->Clone())).Expand().GetSummands();
+					auto tensor_summands = Tensor(As<ScaledTensor>()->GetTensor()).Expand().GetSummands();
 					auto scalar_summands = static_cast<ScaledTensor*>(pointer.get())->GetScale().Expand().GetSummands();
 
 					for (auto& c : scalar_summands) {
@@ -2266,7 +3027,7 @@ namespace Construction {
 								if (!t.IsZeroTensor()) tensors.push_back(t);
 							}*/
 
-							if (!combined.IsZeroTensor()) tensors.push_back(combined);
+							if (!combined.IsZeroTensor()) tensors.push_back(std::move(combined));
 						}
 					}
 
@@ -2278,8 +3039,8 @@ namespace Construction {
 					std::vector<Tensor> tensors;
 
 					// Expand left and right
-					auto expandedLeft = Tensor(std::move(static_cast<MultipliedTensor*>(pointer.get())->GetFirst()->Clone())).Expand().GetSummands();
-					auto expandedRight = Tensor(std::move(static_cast<MultipliedTensor*>(pointer.get())->GetSecond()->Clone())).Expand().GetSummands();
+					auto expandedLeft = Tensor(As<MultipliedTensor>()->GetFirst()).Expand().GetSummands();
+					auto expandedRight = Tensor(As<MultipliedTensor>()->GetSecond()).Expand().GetSummands();
 
 					// Glue them together
 					for (auto& left : expandedLeft) {
@@ -2291,7 +3052,7 @@ namespace Construction {
 								if (!t.IsZeroTensor()) tensors.push_back(t);
 							}*/
 
-							if (!combined.IsZeroTensor()) tensors.push_back(combined);
+							if (!combined.IsZeroTensor()) tensors.push_back(std::move(combined));
 						}
 					}
 
@@ -2307,7 +3068,8 @@ namespace Construction {
                 \brief Fast simplification of tensorial expressions
 
                 Fast simplification of tensorial expressions. It is based on
-                `Canonicalize` and assumes that its result is unique.
+                `Canonicalize` and assumes that its result is unique, which is
+                the case for epsilon-gamma tensors, also with contracted indices.
              */
             Tensor FastSimplify() const {
                 if (IsScaled()) {
@@ -2316,44 +3078,597 @@ namespace Construction {
                 }
 
                 if (IsMultiplied()) {
-                    return Tensor(static_cast<MultipliedTensor*>(pointer.get())->GetFirst()->Clone()).FastSimplify() * Tensor(static_cast<MultipliedTensor*>(pointer.get())->GetSecond()->Clone()).FastSimplify();
+                    return Tensor(As<MultipliedTensor>()->GetFirst()).FastSimplify() * Tensor(As<MultipliedTensor>()->GetSecond()).FastSimplify();
                 }
 
                 if (!IsAdded()) {
                     return Canonicalize();
                 }
 
-                // Get the summands
+                // Simplify the summands
                 auto summands = GetSummands();
 
-                std::vector<Tensor> map_keys;
-                std::vector<Scalar> map_values;
-
                 for (auto& tensor : summands) {
-                    auto simplified = tensor.FastSimplify().SeparateScalefactor();
+                    tensor = tensor.FastSimplify();
+                }
 
-                    auto it = std::find_if(map_keys.begin(), map_keys.end(), [&](const Tensor& _tensor) {
-                        return _tensor.ToString() == simplified.second.ToString();
-                    });
+                std::vector<Tensor> tensors;
+                for (auto& pair : CollectLikeTerms(summands)) {
+                    auto tensor_ = pair.first * pair.second;
+                    if (tensor_.IsZeroTensor()) continue;
+                    tensors.push_back(tensor_);
+                }
+
+                return Add(tensors);
+            }
+        private:
+            /**
+                \brief Collects like terms in a list of canonicalized tensors
+
+                Separates the scale factor of every term once and adds up the
+                scales of all the terms with the same structure, which are found
+                via their structural hash. The terms are returned in the order of
+                their first occurrence, terms whose scale vanishes are dropped.
+
+                \param      terms           The canonicalized terms
+                \returns    The pairs of the collected scale and the term
+             */
+            static std::vector<std::pair<scalar_type, Tensor>> CollectLikeTerms(const std::vector<Tensor>& terms) {
+                std::vector<std::pair<scalar_type, Tensor>> pairs;
+                pairs.reserve(terms.size());
+
+                for (auto& term : terms) {
+                    pairs.push_back(term.SeparateScalefactor());
+                }
+
+                return CollectLikeTerms(std::move(pairs));
+            }
+
+            /**
+                \brief Collects like terms in a list of already separated terms
+
+                Same as above, but the scale factors are already separated.
+             */
+            static std::vector<std::pair<scalar_type, Tensor>> CollectLikeTerms(std::vector<std::pair<scalar_type, Tensor>>&& terms) {
+                std::vector<std::pair<scalar_type, Tensor>> result;
+                result.reserve(terms.size());
+
+                // Position of the terms in the result, found by their structure. The
+                // nodes are shared with the result and therefore do not move.
+                std::unordered_map<const AbstractTensor*, size_t, TensorStructureHash, TensorStructureEqual> positions;
+                positions.reserve(terms.size());
+
+                for (auto& pair : terms) {
+                    auto it = positions.find(pair.second.pointer.get());
+
+                    if (it == positions.end()) {
+                        positions.insert({ pair.second.pointer.get(), result.size() });
+                        result.push_back(std::move(pair));
+                        continue;
+                    }
+
+                    result[it->second].first += pair.first;
+                }
+
+                // Remove the terms that cancelled
+                result.erase(std::remove_if(result.begin(), result.end(), [](const std::pair<scalar_type, Tensor>& pair) {
+                    return pair.first.IsNumeric() && pair.first.ToDouble() == 0;
+                }), result.end());
+
+                return result;
+            }
+
+            /**
+                \brief Symmetrizes the summands by decomposing them into orbits
+
+                Walks the orbit of every summand under the group spanned by the
+                generators, which only works if the canonical form is unique. Each
+                structure is canonicalized once per generator and remembered with
+                its sign relative to the first member of its orbit. The symmetrized
+                summand is then the signed sum over its orbit divided by the orbit
+                length. If a structure is reached with both signs, the orbit and
+                all the summands in it vanish.
+
+                \param      summands        The summands to symmetrize
+                \param      generators      The generators of the group
+                \returns    The pairs of the normalized scale and the orbit sum
+             */
+            static std::vector<std::pair<scalar_type, Tensor>> SymmetrizeOrbits(const std::vector<Tensor>& summands, const std::vector<std::map<Index, Index>>& generators) {
+                struct Orbit {
+                    std::vector<std::pair<int, Tensor>> members;
+                    scalar_type coefficient = 0;
+                    bool vanishes = false;
+                };
+
+                std::vector<Orbit> orbits;
+
+                // Orbit and sign of all the visited structures. The nodes are shared
+                // with the orbit members and therefore do not move.
+                std::unordered_map<const AbstractTensor*, std::pair<size_t, int>, TensorStructureHash, TensorStructureEqual> visited;
+
+                auto sign = [](const scalar_type& scale) {
+                    return scale.ToDouble() < 0 ? -1 : 1;
+                };
+
+                for (auto& summand : summands) {
+                    auto s = summand.SeparateScalefactor();
+                    if (s.second.IsZeroTensor()) continue;
+
+                    auto canonical = s.second.Canonicalize().SeparateScalefactor();
+                    if (canonical.second.IsZeroTensor()) continue;
+
+                    auto it = visited.find(canonical.second.pointer.get());
+
+                    // Already seen in one of the orbits
+                    if (it != visited.end()) {
+                        orbits[it->second.first].coefficient += scalar_type(it->second.second) * s.first * canonical.first;
+                        continue;
+                    }
+
+                    // Walk the new orbit
+                    auto id = orbits.size();
+                    orbits.push_back(Orbit());
+
+                    auto& orbit = orbits.back();
+                    orbit.coefficient = s.first * canonical.first;
+
+                    visited.insert({ canonical.second.pointer.get(), { id, 1 } });
+                    orbit.members.push_back({ 1, std::move(canonical.second) });
+
+                    for (size_t k=0; k<orbit.members.size(); ++k) {
+                        auto member = orbit.members[k];
+                        auto indices = member.second.GetIndices();
+
+                        for (auto& generator : generators) {
+                            auto image = member.second;
+                            image.SetIndices(indices.Shuffle(generator));
+
+                            auto c = image.Canonicalize().SeparateScalefactor();
+                            auto signum = member.first * sign(c.first);
+                            auto found = visited.find(c.second.pointer.get());
+
+                            if (found == visited.end()) {
+                                visited.insert({ c.second.pointer.get(), { id, signum } });
+                                orbit.members.push_back({ signum, std::move(c.second) });
+                            } else if (found->second.second != signum) {
+                                orbit.vanishes = true;
+                            }
+                        }
+                    }
+                }
+
+                std::vector<std::pair<scalar_type, Tensor>> result;
+
+                for (auto& orbit : orbits) {
+                    if (orbit.vanishes) continue;
+
+                    std::vector<Tensor> members;
+                    for (auto& member : orbit.members) {
+                        members.push_back(member.first < 0 ? -member.second : std::move(member.second));
+                    }
+
+                    result.push_back({ Scalar(1, orbit.members.size()) * orbit.coefficient, Tensor::Add(std::move(members)) });
+                }
+
+                return result;
+            }
+
+            /**
+                \brief Symmetrizes the summands by enumerating the group
+
+                Closes the generators under composition and applies every
+                element of the group to every summand. The canonicalized images
+                are collected by their structure.
+
+                \param      summands        The summands to symmetrize
+                \param      generators      The generators of the group
+                \returns    The pairs of the normalized scale and the term
+             */
+            static std::vector<std::pair<scalar_type, Tensor>> SymmetrizeGroup(const std::vector<Tensor>& summands, const std::vector<std::map<Index, Index>>& generators) {
+                // Generate the group, starting from the identity. The fixed points
+                // are dropped s.t. every element has a unique mapping.
+                std::vector<std::map<Index, Index>> elements = { std::map<Index, Index>() };
+
+                for (size_t k=0; k<elements.size(); ++k) {
+                    for (auto& generator : generators) {
+                        auto composed = generator;
+
+                        for (auto& pair : elements[k]) {
+                            auto it = generator.find(pair.second);
+                            composed[pair.first] = (it == generator.end()) ? pair.second : it->second;
+                        }
+
+                        for (auto it = composed.begin(); it != composed.end(); ) {
+                            if (it->first == it->second) it = composed.erase(it);
+                            else ++it;
+                        }
+
+                        if (std::find(elements.begin(), elements.end(), composed) == elements.end()) {
+                            elements.push_back(std::move(composed));
+                        }
+                    }
+                }
+
+                // Apply all the group elements to the summands in parallel
+                auto pool = Parallel::GlobalTaskPool::Instance();
+
+                auto images = pool->ParallelMap<std::vector<std::pair<scalar_type,Tensor>>>(summands, [&](const Tensor& summand) {
+                    auto s = summand.SeparateScalefactor();
+                    auto indices = s.second.GetIndices();
+
+                    std::vector<std::pair<scalar_type,Tensor>> result;
+                    result.reserve(elements.size());
+
+                    for (auto& element : elements) {
+                        auto image = s.second;
+                        image.SetIndices(indices.Shuffle(element));
+
+                        auto canonical = image.Canonicalize().SeparateScalefactor();
+                        if (canonical.second.IsZeroTensor()) continue;
+
+                        result.push_back({ s.first * canonical.first, std::move(canonical.second) });
+                    }
+
+                    return CollectLikeTerms(std::move(result));
+                });
+
+                // Collect the images of all the summands
+                std::vector<std::pair<scalar_type,Tensor>> collected;
+                for (auto& image : images) {
+                    std::move(image.begin(), image.end(), std::back_inserter(collected));
+                }
+
+                auto result = CollectLikeTerms(std::move(collected));
+
+                for (auto& pair : result) {
+                    pair.first = Scalar(1, elements.size()) * pair.first;
+                }
+
+                return result;
+            }
+
+            /**
+                \brief Monomial of epsilons, gammas and deltas with a rational prefactor
+
+                The contraction structure is stored w.r.t. the indices of the whole
+                sum, i.e. partner[i] is the position the i-th index is contracted
+                with by a gamma or delta, and -1 if it sits on the epsilon. The
+                positions on the epsilon are stored in its index order.
+             */
+            struct InvariantMonomial {
+                Construction::Tensor::Fraction coefficient;
+                std::vector<Indices> gammas;
+                std::vector<Indices> epsilons;
+
+                std::vector<int> partner;
+                std::vector<int> epsilon;
+            };
+
+            /**
+                \brief Expands the tensor into monomials of epsilons, gammas and deltas
+
+                Only succeeds if the tensor is a rational linear combination of
+                products of at most one epsilon with Euclidean metrics and deltas.
+
+                \param      tensor      The tensor to expand
+                \param      result      The list the monomials are appended to
+                \returns    True if the tensor could be expanded
+             */
+            static bool ExpandInvariant(const AbstractTensor& tensor, std::vector<InvariantMonomial>& result) {
+                if (tensor.IsZeroTensor()) return true;
+
+                if (tensor.IsAddedTensor()) {
+                    auto& added = static_cast<const AddedTensor&>(tensor);
+                    for (size_t i=0; i<added.Size(); ++i) {
+                        if (!ExpandInvariant(*added.At(i), result)) return false;
+                    }
+                    return true;
+                }
+
+                if (tensor.IsSubstitute()) {
+                    // Only reorders the indices, the monomials refer to them by name
+                    return ExpandInvariant(*static_cast<const SubstituteTensor&>(tensor).GetTensor(), result);
+                }
+
+                if (tensor.IsScaledTensor() || tensor.IsScalar()) {
+                    auto scale = tensor.IsScalar() ? static_cast<const ScalarTensor&>(tensor).GetValue() : static_cast<const ScaledTensor&>(tensor).GetScale();
+                    if (!scale.IsFraction()) return false;
+
+                    std::vector<InvariantMonomial> inner;
+                    if (tensor.IsScalar()) inner.push_back({ Construction::Tensor::Fraction(1), {}, {}, {}, {} });
+                    else if (!ExpandInvariant(*static_cast<const ScaledTensor&>(tensor).GetTensor(), inner)) return false;
+
+                    Construction::Tensor::Fraction factor = *scale.As<Fraction>();
+                    for (auto& monomial : inner) {
+                        monomial.coefficient = monomial.coefficient * factor;
+                        result.push_back(std::move(monomial));
+                    }
+                    return true;
+                }
+
+                if (tensor.IsMultipliedTensor()) {
+                    auto& multiplied = static_cast<const MultipliedTensor&>(tensor);
+
+                    std::vector<InvariantMonomial> first, second;
+                    if (!ExpandInvariant(*multiplied.GetFirst(), first) || !ExpandInvariant(*multiplied.GetSecond(), second)) return false;
+
+                    for (auto& a : first) {
+                        for (auto& b : second) {
+                            InvariantMonomial monomial = a;
+                            monomial.coefficient = a.coefficient * b.coefficient;
+                            monomial.gammas.insert(monomial.gammas.end(), b.gammas.begin(), b.gammas.end());
+                            monomial.epsilons.insert(monomial.epsilons.end(), b.epsilons.begin(), b.epsilons.end());
+
+                            if (monomial.epsilons.size() > 1) return false;
+                            result.push_back(std::move(monomial));
+                        }
+                    }
+                    return true;
+                }
+
+                InvariantMonomial monomial = { Construction::Tensor::Fraction(1), {}, {}, {}, {} };
+                auto indices = tensor.GetIndices();
+
+                if (tensor.IsGammaTensor()) {
+                    if (static_cast<const GammaTensor&>(tensor).GetSignature().first != 0) return false;
+                    monomial.gammas.push_back(indices);
+                } else if (tensor.IsDeltaTensor()) {
+                    monomial.gammas.push_back(indices);
+                } else if (tensor.IsEpsilonTensor()) {
+                    monomial.epsilons.push_back(indices);
+                } else if (tensor.IsEpsilonGammaTensor()) {
+                    auto& epsilonGamma = static_cast<const EpsilonGammaTensor&>(tensor);
+                    if (epsilonGamma.GetNumEpsilons() > 1) return false;
+
+                    unsigned pos = 0;
+                    for (unsigned i=0; i<epsilonGamma.GetNumEpsilons(); ++i, pos += 3) {
+                        monomial.epsilons.push_back(indices.Partial({pos, pos+2}));
+                    }
+                    for (unsigned i=0; i<epsilonGamma.GetNumGammas(); ++i, pos += 2) {
+                        monomial.gammas.push_back(indices.Partial({pos, pos+1}));
+                    }
+                } else {
+                    return false;
+                }
+
+                result.push_back(std::move(monomial));
+                return true;
+            }
+
+            /**
+                \brief Expands all the summands into monomials for the Gram backend
+
+                Succeeds if all indices are three dimensional and every summand
+                expands into monomials in which each of the indices occurs exactly once.
+
+                \param      summands    The summands without their scales
+                \param      indices     The indices of the sum
+                \param      result      The monomials of every summand
+                \returns    True if the Gram backend can be used
+             */
+            static bool GetInvariantMonomials(const std::vector<Tensor>& summands, const Indices& indices, std::vector<std::vector<InvariantMonomial>>& result) {
+                for (auto& index : indices) {
+                    if (index.GetRange().GetDimension() != 3) return false;
+                }
+
+                result.clear();
+                result.resize(summands.size());
+
+                for (size_t i=0; i<summands.size(); ++i) {
+                    if (!ExpandInvariant(*summands[i].pointer, result[i])) return false;
+
+                    for (auto& monomial : result[i]) {
+                        monomial.partner.assign(indices.Size(), -2);
+
+                        for (auto& gamma : monomial.gammas) {
+                            int a = indices.IndexOf(gamma[0]);
+                            int b = indices.IndexOf(gamma[1]);
+                            if (a < 0 || b < 0 || a == b || monomial.partner[a] != -2 || monomial.partner[b] != -2) return false;
+
+                            monomial.partner[a] = b;
+                            monomial.partner[b] = a;
+                        }
+
+                        for (auto& epsilon : monomial.epsilons) {
+                            if (epsilon.Size() != 3) return false;
+
+                            for (auto& index : epsilon) {
+                                int a = indices.IndexOf(index);
+                                if (a < 0 || monomial.partner[a] != -2) return false;
+
+                                monomial.partner[a] = -1;
+                                monomial.epsilon.push_back(a);
+                            }
+                        }
+
+                        if (std::find(monomial.partner.begin(), monomial.partner.end(), -2) != monomial.partner.end()) return false;
+                    }
+                }
+
+                return true;
+            }
+
+            /**
+                \brief Fully contracts two monomials in three Euclidean dimensions
+
+                Every closed loop of gammas gives a trace, i.e. a factor 3. If both
+                have an epsilon, the chains of gammas starting at the first epsilon
+                have to end on the second one and the two epsilons contract to
+                3! times the sign of the induced permutation.
+             */
+            static long long ContractInvariants(const InvariantMonomial& a, const InvariantMonomial& b) {
+                if (a.epsilon.size() != b.epsilon.size()) return 0;
+
+                std::vector<bool> visited(a.partner.size(), false);
+                long long result = 1;
+
+                if (!a.epsilon.empty()) {
+                    std::vector<int> image;
+
+                    for (auto start : a.epsilon) {
+                        int current = start;
+                        visited[current] = true;
+
+                        while (b.partner[current] >= 0) {
+                            int next = b.partner[current];
+                            visited[next] = true;
+
+                            // The chain returns to the same epsilon
+                            if (a.partner[next] < 0) return 0;
+
+                            current = a.partner[next];
+                            visited[current] = true;
+                        }
+
+                        image.push_back(std::distance(b.epsilon.begin(), std::find(b.epsilon.begin(), b.epsilon.end(), current)));
+                    }
+
+                    result = 6;
+                    for (size_t i=0; i<image.size(); ++i) {
+                        for (size_t j=i+1; j<image.size(); ++j) {
+                            if (image[i] > image[j]) result = -result;
+                        }
+                    }
+                }
+
+                // The remaining indices form closed loops
+                for (int i=0; i<visited.size(); ++i) {
+                    if (visited[i]) continue;
+
+                    int current = i;
+                    do {
+                        visited[current] = true;
+                        visited[b.partner[current]] = true;
+                        current = a.partner[b.partner[current]];
+                    } while (current != i);
+
+                    result *= 3;
+                }
+
+                return result;
+            }
+
+            /**
+                \brief Reduced row echelon form of the Gram matrix of the summands
+
+                The entry (i,j) of the Gram matrix is the full contraction of the i-th
+                with the j-th summand. Since it is M^T M of the matrix M of components
+                and the metric is Euclidean, both have the same row space and thus the
+                same reduced row echelon form.
+
+                The minors of the Gram matrix quickly exceed 64 bits, while the reduced
+                row echelon form has small entries. Thus the elimination is done modulo
+                a prime and the result is reconstructed and checked in the fractions.
+
+                \param      monomials   The monomials of every summand
+                \param      maxRank     The known number of linear independent summands or zero
+                \param      result      The reduced row echelon form
+                \returns    True if the reconstruction succeeded
+             */
+            static bool GetGramRowEchelonForm(const std::vector<std::vector<InvariantMonomial>>& monomials, unsigned maxRank, Vector::Matrix<Construction::Tensor::Fraction>& result) {
+                unsigned size = monomials.size();
+
+                // Calculate the Gram matrix
+                std::vector<std::vector<Construction::Tensor::Fraction>> gram (size, std::vector<Construction::Tensor::Fraction>(size));
+
+                // The rows get shorter, thus every row is a task of its own
+                Parallel::GlobalTaskPool::Instance()->ParallelFor(0, size, [&](size_t id) {
+                    for (unsigned j=id; j<size; j++) {
+                        Construction::Tensor::Fraction value (0);
+
+                        for (auto& a : monomials[id]) {
+                            for (auto& b : monomials[j]) {
+                                auto contraction = ContractInvariants(a, b);
+                                if (contraction != 0) value = value + a.coefficient * b.coefficient * Construction::Tensor::Fraction(contraction);
+                            }
+                        }
+
+                        gram[id][j] = value;
+                        gram[j][id] = value;
+                    }
+                }, 1);
+
+                // Eliminate modulo the prime
+                Vector::Matrix<Modular> M (size, size);
+
+                for (unsigned i=0; i<size; i++) {
+                    for (unsigned j=0; j<size; j++) {
+                        if (gram[i][j] == Construction::Tensor::Fraction(0)) continue;
+                        if (!Modular::IsRepresentable(gram[i][j])) return false;
+
+                        M(i,j) = Modular(gram[i][j]);
+                    }
+                }
+
+                unsigned rank = M.ToRowEchelonForm(maxRank);
+
+                // Reconstruct the fractions
+                result = Vector::Matrix<Construction::Tensor::Fraction>(size, size);
+                std::vector<unsigned> leads;
+
+                for (unsigned r=0; r<rank; r++) {
+                    bool foundLead = false;
+
+                    for (unsigned j=0; j<size; j++) {
+                        Modular x = static_cast<const Vector::Matrix<Modular>&>(M)(r,j);
+                        if (x == Modular(0)) continue;
+
+                        Construction::Tensor::Fraction value;
+                        if (!x.ToFraction(value)) return false;
+
+                        result(r,j) = value;
+
+                        if (!foundLead) {
+                            leads.push_back(j);
+                            foundLead = true;
+                        }
+                    }
+                }
+
+                // Check that every summand is the stated combination of the pivots. Then
+                // the pivot summands are linear independent and the result is exact.
+                for (unsigned j=0; j<size; j++) {
+                    std::vector<std::pair<unsigned, Construction::Tensor::Fraction>> combination;
+
+                    for (unsigned r=0; r<rank; r++) {
+                        auto x = static_cast<const Vector::Matrix<Construction::Tensor::Fraction>&>(result)(r,j);
+                        if (x != Construction::Tensor::Fraction(0)) combination.push_back({ leads[r], x });
+                    }
+
+                    for (unsigned i=0; i<size; i++) {
+                        Construction::Tensor::Fraction value (0);
+
+                        for (auto& pair : combination) {
+                            value = value + pair.second * gram[i][pair.first];
+                        }
+
+                        if (value != gram[i][j]) return false;
+                    }
+                }
+
+                return true;
+            }
+
+            /**
+                \brief Evaluates the components of the summands
 
-                    if (it == map_keys.end()) {
-                        map_keys.push_back(simplified.second);
-                        map_values.push_back(simplified.first);
-                        continue;
-                    }
+                The column i contains the components of the i-th summand for
+                every index combination that is canonical under the symmetry.
+             */
+            static Vector::Matrix<Construction::Tensor::Fraction> GetComponentMatrix(const std::vector<Tensor>& summands, const Indices& indices, const Symmetry& symmetry) {
+                auto combinations = symmetry.GetIndexCombinationTable(indices);
 
-                    map_values[std::distance(map_keys.begin(), it)] += simplified.first;
-                }
+                unsigned dimension = combinations->Size();
 
-                std::vector<Tensor> tensors;
-                for (int i=0; i<map_keys.size(); ++i) {
-                    auto tensor_ = map_keys[i] * map_values[i];
-                    if (tensor_.IsZeroTensor()) continue;
-                    tensors.push_back(tensor_);
-                }
+                // Evaluate the columns in parallel, every summand writes its own one
+                auto columns = Parallel::GlobalTaskPool::Instance()->ParallelMap<std::vector<std::pair<unsigned, Construction::Tensor::Fraction>>>(summands, [&](const Tensor& tensor) {
+                    return tensor.EvaluateSparseColumn(indices, *combinations);
+                }, 1);
 
-                return Add(tensors);
+                // Merge the columns into the matrix
+                return Vector::Matrix<Construction::Tensor::Fraction>(dimension, columns);
             }
+        public:
 
 			/**
 				\brief Simplify the expression
@@ -2364,12 +3679,31 @@ namespace Construction {
 				equal if they have the same components in one coordinate system, this is completely
 				fine.
 
+				If the number of linear independent summands is known a-priori, e.g. from
+				`Generator::InvariantDimension`, the elimination stops as soon as that
+				many independent summands are found. Note that this has to bound the
+				rank of the summands themselves, e.g. the dimension of the invariant
+				tensors with a symmetry only applies if every summand has this symmetry.
+
+				Likewise, if every summand is known to have a symmetry, only the
+				components at the canonical index combinations are evaluated, since
+				all the others are equal to them up to a sign.
+
+				Linear combinations of epsilons, Euclidean metrics and deltas in three
+				dimensions are decided by the Gram matrix of their contractions instead
+				of their 3^n components, if they have less monomials than components.
+
+				\param	 maxRank	The known number of linear independent summands or zero
+				\param	 symmetry	The symmetry of every summand
 				\returns {Tensor}	The simplified tensorial expression
 			 */
-			Tensor Simplify() const {
+			Tensor Simplify(unsigned maxRank = 0, const Symmetry& symmetry = Symmetry()) const {
                 Construction::Logger::Debug("Simplify a tensor");
 
-				// Scaling heuristics
+                Common::CancellationToken::Current().ThrowIfCancelled();
+
+				// Scaling heuristics. The bound refers to the summands of this tensor,
+				// not to the ones of the scaled tensor, so it is not passed on.
 				if (IsScaled()) {
 					auto it = SeparateScalefactor();
 					return it.first * it.second.Simplify();
@@ -2377,7 +3711,7 @@ namespace Construction {
 
 				// Multiplied tensors heuristics
 				if (IsMultiplied()) {
-					return Tensor(static_cast<MultipliedTensor*>(pointer.get())->GetFirst()->Clone()).Simplify() * Tensor(static_cast<MultipliedTensor*>(pointer.get())->GetSecond()->Clone()).Simplify();
+					return Tensor(As<MultipliedTensor>()->GetFirst()).Simplify() * Tensor(As<MultipliedTensor>()->GetSecond()).Simplify();
 				}
 
 				// If the tensor is not added, check if it is zero, otherwise no further simplification possible
@@ -2388,85 +3722,43 @@ namespace Construction {
 				// Get the summands
 				auto summands = GetSummands();
 
-				// Initialize
-                std::map<unsigned,Vector::Vector<double>> vectors;
-
 				// Get the indices of the resulting tensor
 				auto indices = GetIndices();
-				auto combinations = GetAllIndexCombinations();
-
-				unsigned dimension = combinations.size();
 
-				Vector::Matrix<Construction::Tensor::Fraction> M (dimension, summands.size());
-
-				// Insert the values into the matrix
-				{
-					std::mutex mutex;
-
-                    Common::TaskPool pool(4);
-
-					for (int i=0; i<summands.size(); i++) {
-						pool.Enqueue([&](unsigned id, const Tensor& tensor) {
+				std::vector<Tensor> columns;
+				for (auto& summand : summands) {
+					columns.push_back(summand.SeparateScalefactor().second);
+				}
 
-							for (int j=0; j<dimension; j++) {
-								IndexAssignments assignment;
+                // Sums of epsilons and gammas can be decided by the Gram matrix of their
+                // contractions instead of their 3^n components. Its size only depends on
+                // the number of terms, so use it if there are less than components.
+                std::vector<std::vector<InvariantMonomial>> monomials;
+                bool useGram = false;
 
-								// Convert into index assignment
-                        		int k = 0;
-                        		for (auto &index : indices) {
-                            		assignment[index.GetName()] = combinations[j][k];
-                            		k++;
-                        		}
+                if (GetInvariantMonomials(columns, indices, monomials)) {
+                    size_t numMonomials = 0;
+                    for (auto& list : monomials) numMonomials += list.size();
 
-                        		// Calculate the value of the assignment
-                                Construction::Tensor::Fraction value;
+                    size_t numComponents = 1;
+                    if (!symmetry.IsEmpty()) numComponents = symmetry.GetIndexCombinationTable(indices)->Size();
+                    else for (unsigned i=0; i<indices.Size() && numComponents <= numMonomials; ++i) numComponents *= 3;
 
-                                {
-                                    auto _value = tensor(assignment);
-                                    if (_value.IsFraction())
-                                        value = *_value.As<Fraction>();
-                                    else value = Construction::Tensor::Fraction::FromDouble(_value.ToDouble());
-                                }
+                    useGram = numMonomials < numComponents;
+                }
 
-                        		// only lock and insert if necessary
-                        		if (value != Construction::Tensor::Fraction(0)) {
-                        			std::unique_lock<std::mutex> lock(mutex);
+				Vector::Matrix<Construction::Tensor::Fraction> M (0, 0);
 
-                        			// Insert the value into the matrix
-                        			M(j,id) = value;
-                        		}
-							}
+				if (!useGram || !GetGramRowEchelonForm(monomials, maxRank, M)) {
+					M = GetComponentMatrix(columns, indices, symmetry);
 
-						}, i, summands[i].SeparateScalefactor().second);
-                    }
+                    Construction::Logger::Debug("Finished insert into matrix");
 
-					pool.Wait();
+                    // Reduce to reduced matrix echelon form. Double lines are reduced
+                    // to zero right away, so there is no need to remove them first.
+                    M.ToRowEchelonForm(maxRank);
 				}
 
-                Construction::Logger::Debug("Finished insert into matrix");
-
-                // Remove double lines
-                {
-                    std::vector<Construction::Vector::Vector<Construction::Tensor::Fraction>> vector;
-                    for (int i = 0; i < M.GetNumberOfRows(); ++i) {
-                        auto v = M.GetRowVector(i);
-
-                        auto it = std::find(vector.begin(), vector.end(), v);
-                        if (it == vector.end()) {
-                            vector.push_back(v);
-                            continue;
-                        }
-
-                        // Set all entries in the row to zero
-                        for (int j = 0; j < M.GetNumberOfColumns(); ++j) {
-                            M(i, j) = 0;
-                        }
-                    }
-                }
-
-                // Reduce to reduced matrix echelon form
-                M.ToRowEchelonForm();
-
                 // Now start collecting the tensors
                 Tensor result = Tensor::Zero();
 
@@ -2528,16 +3820,16 @@ namespace Construction {
 
 			inline std::pair<scalar_type, Tensor> SeparateScalefactor() const {
 				if (pointer->IsScaledTensor()) {
-					return { As<ScaledTensor>()->GetScale(), Tensor(TensorPointer(As<ScaledTensor>()->GetTensor()->Clone())) };
+					return { As<ScaledTensor>()->GetScale(), Tensor(As<ScaledTensor>()->GetTensor()) };
 				} else if (pointer->IsSubstitute()) {
-					auto res = Tensor(std::move(static_cast<SubstituteTensor*>(pointer.get())->GetTensor()->Clone())).SeparateScalefactor();
+					auto res = Tensor(As<SubstituteTensor>()->GetTensor()).SeparateScalefactor();
 					return { res.first, Tensor::Substitute(res.second, GetIndices()) };
 				} else if (pointer->IsScalar()) {
                     auto scale = static_cast<ScalarTensor*>(pointer.get())->GetValue();
                     return { scale, Tensor::One() };
                 } else if (pointer->IsMultipliedTensor()) {
-                    auto a1 = Tensor(TensorPointer(As<MultipliedTensor>()->GetFirst()->Clone())).SeparateScalefactor();
-                    auto a2 = Tensor(TensorPointer(As<MultipliedTensor>()->GetSecond()->Clone())).SeparateScalefactor();
+                    auto a1 = Tensor(As<MultipliedTensor>()->GetFirst()).SeparateScalefactor();
+                    auto a2 = Tensor(As<MultipliedTensor>()->GetSecond()).SeparateScalefactor();
                     return { a1.first * a2.first , a1.second * a2.second };
                 } else if (pointer->IsAddedTensor()) {
                     auto factorized = FactorizeOveralScale();
@@ -2550,7 +3842,7 @@ namespace Construction {
                     if (!factorized.IsScaled()) return { 1, *this };
 
                     // Return the scale and the rest
-                    return { factorized.As<ScaledTensor>()->GetScale(), Tensor(TensorPointer(factorized.As<ScaledTensor>()->GetTensor()->Clone())) };
+                    return { factorized.As<ScaledTensor>()->GetScale(), Tensor(factorized.As<ScaledTensor>()->GetTensor()) };
                 } else {
 					return { 1, *this };
 				}
@@ -2649,14 +3941,14 @@ namespace Construction {
                         auto scale = tensor.As<ScaledTensor>()->GetScale().FactorizeOveralScale();
 
                         if (scale.IsMultiplied()) {
-                            result += scalar_type(scale.As<MultipliedScalar>()->GetFirst()->Clone()) * scalar_type(name, variableCount++) * Tensor(tensor.As<ScaledTensor>()->GetTensor()->Clone());
+                            result += scalar_type(scale.As<MultipliedScalar>()->GetFirst()->Clone()) * scalar_type(name, variableCount++) * Tensor(tensor.As<ScaledTensor>()->GetTensor());
                         } else {
-                            result += scalar_type(name, variableCount++) * Tensor(tensor.As<ScaledTensor>()->GetTensor()->Clone());
+                            result += scalar_type(name, variableCount++) * Tensor(tensor.As<ScaledTensor>()->GetTensor());
                         }
 					} else if (tensor.IsMultiplied()) {
-						MultipliedTensor* _tensor = static_cast<MultipliedTensor*>(tensor.pointer.get());
-						auto first = Tensor(_tensor->GetFirst()->Clone()).SeparateScalefactor();
-						auto second = Tensor(_tensor->GetSecond()->Clone()).SeparateScalefactor();
+						auto _tensor = tensor.As<MultipliedTensor>();
+						auto first = Tensor(_tensor->GetFirst()).SeparateScalefactor();
+						auto second = Tensor(_tensor->GetSecond()).SeparateScalefactor();
 						if (first.first.HasVariables() || second.first.HasVariables()) {
 							result += scalar_type(name, variableCount++) * first.second * second.second;
 						} else result += first.second * second.second;
@@ -2731,9 +4023,14 @@ namespace Construction {
 			/**
 				\brief Convert the tensorial equation into a homogeneous linear system
 
+				Each component of the equation gives a row. If the equation is known
+				to have a symmetry for all values of the variables, only the canonical
+				index combinations are evaluated, since the other rows are the same up
+				to a sign.
 
+				\param	 symmetry	The symmetry of the equation
 			 */
-			std::pair< Vector::Matrix<Construction::Tensor::Fraction>, std::vector<scalar_type> > ToHomogeneousLinearSystem() const {
+			std::pair< Vector::Matrix<Construction::Tensor::Fraction>, std::vector<scalar_type> > ToHomogeneousLinearSystem(const Symmetry& symmetry = Symmetry()) const {
                 // Ignore zero tensors
                 if (IsZeroTensor()) {
                     return { Vector::Matrix<Construction::Tensor::Fraction>(0,0), { } };
@@ -2744,47 +4041,27 @@ namespace Construction {
 
 				// Get all the index assignments
 				auto indices = GetIndices();
-				auto combinations = GetAllIndexCombinations();
+				auto combinations = symmetry.GetIndexCombinationTable(indices);
 
-				// Get the dimensions of the system
-				unsigned n = combinations.size();
-				unsigned m = variables.size();
+				// Get the number of equations
+				unsigned n = combinations->Size();
 
-				// Create matrix
-				Vector::Matrix<Construction::Tensor::Fraction> M(n, m);
 				std::vector<scalar_type> _variables;
-
-				// Iterate over all variables
-				int i = 0;
 				for (auto& pair : variables) {
 					_variables.push_back(pair.first);
+				}
 
-					// Evaluate all the components
-					for (int j=0; j<combinations.size(); j++) {
-						IndexAssignments assignment;
-
-                        // Convert into index assignment
-                        int k = 0;
-                        for (auto &index : indices) {
-                            assignment[index.GetName()] = combinations[j][k];
-                            k++;
-                        }
-
-                        // Plug the value of the assignment into the matrix
-                        auto s = (pair.second)(assignment);
-                        if (s.IsFraction()) {
-                            M(j,i) = *s.As<Fraction>();
-                        } else if (s.IsFloatingPoint()) {
-                            M(j, i) = Fraction::FromDouble(s.ToDouble());
-                        }
-					}
+				// Evaluate the components of every variable in parallel
+				auto columns = Parallel::GlobalTaskPool::Instance()->ParallelMap<std::vector<std::pair<unsigned, Construction::Tensor::Fraction>>>(variables, [&](const std::pair<scalar_type, Tensor>& pair) {
+					return pair.second.EvaluateSparseColumn(indices, *combinations);
+				}, 1);
 
-					i++;
-				}
+				// Create matrix
+				Vector::Matrix<Construction::Tensor::Fraction> M(n, columns);
 
                 Construction::Logger::Debug("Finished matrix for equation");
 
-				return { M, _variables };
+				return { std::move(M), std::move(_variables) };
 			}
         public:
             Tensor FactorizeOveralScale() const {
@@ -2860,6 +4137,110 @@ namespace Construction {
                 return permutations;
 			}
 
+            /**
+                \brief Index permutations of an epsilon-gamma tensor modulo its symmetries
+
+                Symmetrizing an epsilon-gamma tensor over all the k! permutations of
+                the given indices generates every term many times, since the tensor
+                is invariant under its stabiliser, i.e. swapping the indices
+                of a gamma and exchanging two gammas. It is therefore sufficient to
+                enumerate one representative of each coset, all of which have the same
+                weight. Gammas with both indices in the symmetrized set become a
+                perfect matching of the remaining indices, all the other slots are
+                filled with every possible choice.
+
+                If two of the indices sit on the same epsilon, the symmetrization
+                vanishes and no permutation is returned.
+
+                \param      indices         The indices to symmetrize over
+                \returns    The representatives of the index permutations
+             */
+            std::vector<Indices> PermuteEpsilonGammaIndices(const Indices& indices) const {
+                auto tensorIndices = GetIndices();
+                auto tensor = As<EpsilonGammaTensor>();
+
+                unsigned numEpsilonIndices = 3 * tensor->GetNumEpsilons();
+
+                // Slots that are filled independently and gammas that are symmetrized in both slots
+                std::vector<unsigned> singleSlots;
+                std::vector<unsigned> pairSlots;
+                std::vector<unsigned> epsilonSlots (tensor->GetNumEpsilons(), 0);
+
+                for (unsigned i=0; i<tensorIndices.Size(); ++i) {
+                    if (!indices.ContainsIndex(tensorIndices[i])) continue;
+
+                    if (i < numEpsilonIndices) {
+                        // Symmetric in two indices of the same epsilon => zero
+                        if (++epsilonSlots[i / 3] > 1) return {};
+                        singleSlots.push_back(i);
+                        continue;
+                    }
+
+                    // Check the partner index of the gamma
+                    unsigned partner = (i - numEpsilonIndices) % 2 == 0 ? i+1 : i-1;
+
+                    if (!indices.ContainsIndex(tensorIndices[partner])) {
+                        singleSlots.push_back(i);
+                    } else if (partner > i) {
+                        pairSlots.push_back(i);
+                    }
+                }
+
+                // Not all of the indices belong to the tensor
+                if (singleSlots.size() + 2 * pairSlots.size() != indices.Size()) {
+                    return PermuteIndices(indices);
+                }
+
+                std::vector<Indices> permutations;
+                std::vector<bool> used (indices.Size(), false);
+                Indices current = tensorIndices;
+
+                // Fill the gammas with a perfect matching of the remaining indices
+                std::function<void(unsigned)> matching = [&](unsigned j) {
+                    if (j == pairSlots.size()) {
+                        permutations.push_back(current);
+                        return;
+                    }
+
+                    // The first free index is always in the first slot of the next gamma
+                    unsigned first = std::distance(used.begin(), std::find(used.begin(), used.end(), false));
+                    used[first] = true;
+                    current[pairSlots[j]] = indices[first];
+
+                    for (unsigned second=first+1; second<indices.Size(); ++second) {
+                        if (used[second]) continue;
+
+                        used[second] = true;
+                        current[pairSlots[j]+1] = indices[second];
+                        matching(j+1);
+                        used[second] = false;
+                    }
+
+                    used[first] = false;
+                };
+
+                // Fill the single slots with every choice
+                std::function<void(unsigned)> singles = [&](unsigned j) {
+                    if (j == singleSlots.size()) {
+                        matching(0);
+                        return;
+                    }
+
+                    for (unsigned k=0; k<indices.Size(); ++k) {
+                        if (used[k]) continue;
+
+                        used[k] = true;
+                        current[singleSlots[j]] = indices[k];
+                        singles(j+1);
+                        used[k] = false;
+                    }
+                };
+
+                singles(0);
+
+                return permutations;
+            }
+
             /**
                 \brief Symmetrizes the tensor in the given indices
 
@@ -2873,6 +4254,8 @@ namespace Construction {
 			Tensor Symmetrize(const Indices& indices) const {
                 Construction::Logger::Debug("Start symmetrization of ", ToString());
 
+                Common::CancellationToken::Current().ThrowIfCancelled();
+
 				// Handle sums differently
 				if (IsAdded()) {
 					auto summands = GetSummands();
@@ -2883,28 +4266,19 @@ namespace Construction {
 
 					// Symmetrize all the summands in parallel
 					{
-						bool firstEntry = true;
-						std::mutex mutex;
-
-                        Common::TaskPool pool(4);
+						symmetrizedSummands = Parallel::GlobalTaskPool::Instance()->ParallelMap<std::pair<scalar_type,Tensor>>(summands, [&](const Tensor& tensor) {
+							return tensor.Symmetrize(indices).SeparateScalefactor();
+						}, 1);
 
-						symmetrizedSummands = pool.Map<std::pair<scalar_type,Tensor>, Tensor>(summands, [&](const Tensor& tensor) {
-							auto result = tensor.Symmetrize(indices).SeparateScalefactor();
+						// Check if all of them have the scale of the first entry
+						if (symmetrizedSummands.size() > 0) overalScale = symmetrizedSummands[0].first;
 
-							// Extract the scale of the first entry
-							{
-								std::unique_lock<std::mutex> lock(mutex);
-								if (firstEntry) {
-									firstEntry = false;
-									overalScale = result.first;
-								}
+						for (auto& pair : symmetrizedSummands) {
+							if (overalScale != pair.first) {
+								hasSameScale = false;
+								break;
 							}
-
-							// If this has a different scale, remember this
-							if (overalScale != result.first) hasSameScale = false;
-
-							return result;
-						});
+						}
 
                         // Sort by indices
                         std::sort(symmetrizedSummands.begin(), symmetrizedSummands.end(), [&](const std::pair<scalar_type, Tensor>& a, const std::pair<scalar_type, Tensor>& b) {
@@ -2926,49 +4300,19 @@ namespace Construction {
 							}
 						}
 
-						std::vector< std::pair<scalar_type, Tensor> > reduced;
+						// Collect the like terms
+						auto reduced = CollectLikeTerms(stack);
 						scalar_type lastScale;
 						bool allTheSameScale=true;
 
-						{
-							bool firstEntry = true;
-
-							while (stack.size() > 0) {
-								// Get the first element from the stack
-								auto s = stack[0].SeparateScalefactor();
-								Tensor current = std::move(s.second);
-								Scalar scale = std::move(s.first);
-
-								// Remove the first element
-								stack.erase(stack.begin());
-
-								// Iterate over all the other summands
-								for (int i=0; i<stack.size(); i++) {
-									auto t = stack[i].SeparateScalefactor();
-									Tensor newTerm = std::move(t.second);
-									Scalar newScale = std::move(t.first);
-
-									// If the tensor is the same after canonicalization modulo scale,
-									// change the scale of the original tensor and remove the new one
-									// from the stack.
-									if (newTerm.GetType() == current.GetType() && newTerm.GetIndices() == current.GetIndices()) {
-										scale += newScale;
-										stack.erase(stack.begin() + i);
-										i--;
-									}
-								}
-
-								if (!scale.IsNumeric() || scale.ToDouble() != 0) {
-									if (firstEntry) {
-										firstEntry = false;
-										lastScale = scale;
-									}
-
-									if (lastScale != scale) {
-										allTheSameScale = false;
-									}
-									reduced.push_back({ scale, current });
-								}
+						if (reduced.size() > 0) {
+							lastScale = reduced[0].first;
+						}
+
+						for (auto& pair : reduced) {
+							if (lastScale != pair.first) {
+								allTheSameScale = false;
+								break;
 							}
 						}
 
@@ -3003,31 +4347,14 @@ namespace Construction {
 					} else {
 						std::vector<Tensor> combined;
 
-                        std::vector<Tensor> map_keys;
-                        std::vector<scalar_type> map_values;
-
-						// Iterate over all symmetrized pairs
-						for (auto& pair : symmetrizedSummands) {
+						// Collect all the symmetrized pairs
+						for (auto& pair : CollectLikeTerms(std::move(symmetrizedSummands))) {
 							// Ignore zeroes
 							if (pair.second.IsZeroTensor()) continue;
 
-							//combined.push_back(pair.first * pair.second);
-                            auto it = std::find_if(map_keys.begin(), map_keys.end(), [&](const Tensor& _tensor) {
-                                return _tensor.ToString() == pair.second.ToString();
-                            });
-
-                            if (it == map_keys.end()) {
-                                map_keys.push_back(pair.second);
-                                map_values.push_back(pair.first);
-                            } else {
-                                map_values[std::distance(map_keys.begin(), it)] += pair.first;
-                            }
+							combined.push_back(pair.first * pair.second);
 						}
 
-                        for (int i=0; i<map_keys.size(); ++i) {
-                            combined.push_back(map_keys[i] * map_values[i]);
-                        }
-
 						return std::move(Tensor::Add(std::move(combined)));
 					}
 				}
@@ -3046,8 +4373,11 @@ namespace Construction {
 				// Do not waste time on zero tensor
 				if (IsZeroTensor()) return *this;
 
-				// Get the permutation of the tensor
-				auto permutations = PermuteIndices(indices);
+				// Get the permutation of the tensor. For epsilon-gamma tensors it is
+				// enough to look at one permutation per coset of the symmetries of the
+				// tensor. Since all of them have the same weight, the normalization
+				// below stays the inverse number of permutations.
+				auto permutations = IsEpsilonGamma() ? PermuteEpsilonGammaIndices(indices) : PermuteIndices(indices);
 
 				// Prepare result
 				Tensor result = Tensor::Zero();
@@ -3058,9 +4388,7 @@ namespace Construction {
 
 					// Move the tensors on the stack
 					{
-                        Common::TaskPool pool(4);
-
-						stack = pool.Map<Tensor,Indices>(permutations, [this](const Indices& indices) {
+						stack = Parallel::GlobalTaskPool::Instance()->ParallelMap<Tensor>(permutations, [this](const Indices& indices) {
 							Tensor clone = *this;
 							clone.SetIndices(indices);
 							return clone.Canonicalize();
@@ -3069,35 +4397,9 @@ namespace Construction {
 
 					std::vector<Tensor> combined;
 
-					// Iterate over all
-					while (stack.size() > 0) {
-						// Get the first element from the stack
-						auto s = stack[0].SeparateScalefactor();
-						Tensor current = std::move(s.second);
-						Scalar scale = std::move(s.first);
-
-						// Remove the first element
-						stack.erase(stack.begin());
-
-						// Iterate over all the other summands
-						for (int i=0; i<stack.size(); i++) {
-							auto t = stack[i].SeparateScalefactor();
-							Tensor newTerm = std::move(t.second);
-							Scalar newScale = std::move(t.first);
-
-							// If the tensor is the same after canonicalization modulo scale,
-							// change the scale of the original tensor and remove the new one
-							// from the stack.
-                            if (newTerm.ToString() == current.ToString()) {
-								scale += newScale;
-								stack.erase(stack.begin() + i);
-								i--;
-							}
-						}
-
-						if (!scale.IsNumeric() || scale.ToDouble() != 0) {
-							if (!current.IsZeroTensor()) combined.push_back(scale * current);
-						}
+					// Collect the like terms
+					for (auto& pair : CollectLikeTerms(stack)) {
+						if (!pair.second.IsZeroTensor()) combined.push_back(pair.first * pair.second);
 					}
 
                     // Sort
@@ -3133,6 +4435,8 @@ namespace Construction {
                 \returns    Tensor          The anti-symmetrized tensor
              */
 			Tensor AntiSymmetrize(const Indices& indices) const {
+                Common::CancellationToken::Current().ThrowIfCancelled();
+
                 // Handle sums differently
 				if (IsAdded()) {
 					auto summands = GetSummands();
@@ -3143,28 +4447,19 @@ namespace Construction {
 
 					// Symmetrize all the summands in parallel
 					{
-						bool firstEntry = true;
-						std::mutex mutex;
-
-                        Common::TaskPool pool(4);
+						symmetrizedSummands = Parallel::GlobalTaskPool::Instance()->ParallelMap<std::pair<scalar_type,Tensor>>(summands, [&](const Tensor& tensor) {
+							return tensor.AntiSymmetrize(indices).SeparateScalefactor();
+						}, 1);
 
-						symmetrizedSummands = pool.Map<std::pair<scalar_type,Tensor>, Tensor>(summands, [&](const Tensor& tensor) {
-							auto result = tensor.AntiSymmetrize(indices).SeparateScalefactor();
+						// Check if all of them have the scale of the first entry up to a sign
+						if (symmetrizedSummands.size() > 0) overalScale = symmetrizedSummands[0].first;
 
-							// Extract the scale of the first entry
-							{
-								std::unique_lock<std::mutex> lock(mutex);
-								if (firstEntry) {
-									firstEntry = false;
-									overalScale = result.first;
-								}
+						for (auto& pair : symmetrizedSummands) {
+							if (overalScale != pair.first && overalScale != -pair.first) {
+								hasSameScale = false;
+								break;
 							}
-
-							// If this has a different scale, remember this
-                            if (overalScale != result.first && overalScale != -result.first) hasSameScale = false;
-
-							return result;
-						});
+						}
 					}
 
 					Tensor result = Tensor::Zero();
@@ -3184,49 +4479,19 @@ namespace Construction {
 							}
 						}
 
-						std::vector< std::pair<scalar_type, Tensor> > reduced;
+						// Collect the like terms
+						auto reduced = CollectLikeTerms(stack);
 						scalar_type lastScale;
 						bool allTheSameScale=true;
 
-						{
-							bool firstEntry = true;
-
-							while (stack.size() > 0) {
-								// Get the first element from the stack
-								auto s = stack[0].SeparateScalefactor();
-								Tensor current = std::move(s.second);
-								Scalar scale = std::move(s.first);
-
-								// Remove the first element
-								stack.erase(stack.begin());
-
-								// Iterate over all the other summands
-								for (int i=0; i<stack.size(); i++) {
-									auto t = stack[i].SeparateScalefactor();
-									Tensor newTerm = std::move(t.second);
-									Scalar newScale = std::move(t.first);
-
-									// If the tensor is the same after canonicalization modulo scale,
-									// change the scale of the original tensor and remove the new one
-									// from the stack.
-									if (newTerm.GetType() == current.GetType() && newTerm.GetIndices() == current.GetIndices()) {
-										scale += newScale;
-										stack.erase(stack.begin() + i);
-										i--;
-									}
-								}
-
-								if (!scale.IsNumeric() || scale.ToDouble() != 0) {
-									if (firstEntry) {
-										firstEntry = false;
-										lastScale = scale;
-									}
-
-									if (lastScale != scale && lastScale != -scale) {
-										allTheSameScale = false;
-									}
-									reduced.push_back({ scale, current });
-								}
+						if (reduced.size() > 0) {
+							lastScale = reduced[0].first;
+						}
+
+						for (auto& pair : reduced) {
+							if (lastScale != pair.first && lastScale != -pair.first) {
+								allTheSameScale = false;
+								break;
 							}
 						}
 
@@ -3282,9 +4547,7 @@ namespace Construction {
 					{
                         auto originalIndices = GetIndices();
 
-                        Common::TaskPool pool(4);
-
-						stack = pool.Map<Tensor,Indices>(permutations, [this, &originalIndices](const Indices& indices) {
+						stack = Parallel::GlobalTaskPool::Instance()->ParallelMap<Tensor>(permutations, [this, &originalIndices](const Indices& indices) {
 							Tensor clone = *this;
 							clone.SetIndices(indices);
 
@@ -3299,35 +4562,9 @@ namespace Construction {
 						});
 					}
 
-					// Iterate over all
-					while (stack.size() > 0) {
-						// Get the first element from the stack
-						auto s = stack[0].SeparateScalefactor();
-						Tensor current = std::move(s.second);
-						Scalar scale = std::move(s.first);
-
-						// Remove the first element
-						stack.erase(stack.begin());
-
-						// Iterate over all the other summands
-						for (int i=0; i<stack.size(); i++) {
-							auto t = stack[i].SeparateScalefactor();
-							Tensor newTerm = std::move(t.second);
-							Scalar newScale = std::move(t.first);
-
-							// If the tensor is the same after canonicalization modulo scale,
-							// change the scale of the original tensor and remove the new one
-							// from the stack.
-							if (newTerm.GetType() == current.GetType() && newTerm.GetIndices() == current.GetIndices()) {
-								scale += newScale;
-								stack.erase(stack.begin() + i);
-								i--;
-							}
-						}
-
-						if (!scale.IsNumeric() || scale.ToDouble() != 0) {
-							result += scale * current;
-						}
+					// Collect the like terms
+					for (auto& pair : CollectLikeTerms(stack)) {
+						result += pair.first * pair.second;
 					}
 				}
 
@@ -3347,6 +4584,8 @@ namespace Construction {
             Tensor ExchangeSymmetrize(const Indices& from, const Indices& indices) const {
                 Construction::Logger::Debug("Start exchange symmetrization of ", ToString());
 
+                Common::CancellationToken::Current().ThrowIfCancelled();
+
                 if (IsAdded()) {
                     auto summands = GetSummands();
 
@@ -3357,8 +4596,6 @@ namespace Construction {
 
 					// Symmetrize all the summands in parallel
 					{
-						bool firstEntry = true;
-						std::mutex mutex;
                         auto originalIndices = GetIndices();
 
                         // Generate tensor mapping
@@ -3367,30 +4604,18 @@ namespace Construction {
                             mapping[from[i]] = indices[i];
                         }
 
-                        Common::TaskPool pool(4);
-
-						symmetrizedSummands = pool.Map<std::pair<scalar_type,Tensor>, Tensor>(summands, [&](const Tensor& tensor) {
+						symmetrizedSummands = Parallel::GlobalTaskPool::Instance()->ParallelMap<std::pair<scalar_type,Tensor>>(summands, [&](const Tensor& tensor) {
                             // Call exchange symmetrization on the summand
-							auto result = tensor.ExchangeSymmetrize(tensor.GetIndices(), tensor.GetIndices().Shuffle(mapping)).SeparateScalefactor();
-
-							// Extract the scale of the first entry
-							{
-								std::unique_lock<std::mutex> lock(mutex);
-
-								if (firstEntry) {
-									firstEntry = false;
-									overalScale = result.first;
-								}
-							}
+							return tensor.ExchangeSymmetrize(tensor.GetIndices(), tensor.GetIndices().Shuffle(mapping)).SeparateScalefactor();
+                        }, 1);
 
-							// If this has a different scale, remember this
-                            if (overalScale != result.first && overalScale != -result.first) hasSameScale = false;
-                            if (!hasVariables) {
-                                if (result.first.HasVariables()) hasVariables = true;
-                            }
+                        // Check if all of them have the scale of the first entry up to a sign
+                        if (symmetrizedSummands.size() > 0) overalScale = symmetrizedSummands[0].first;
 
-                            return result;
-                        });
+                        for (auto& pair : symmetrizedSummands) {
+                            if (overalScale != pair.first && overalScale != -pair.first) hasSameScale = false;
+                            if (pair.first.HasVariables()) hasVariables = true;
+                        }
 
                         // If all have the same scale, expand the sum and sort by indices
                         if (!hasVariables) {
@@ -3428,49 +4653,19 @@ namespace Construction {
 							}
 						}
 
-						std::vector< std::pair<scalar_type, Tensor> > reduced;
+						// Collect the like terms
+						auto reduced = CollectLikeTerms(stack);
 						scalar_type lastScale;
 						bool allTheSameScale=true;
 
-						{
-							bool firstEntry = true;
-
-							while (stack.size() > 0) {
-								// Get the first element from the stack
-								auto s = stack[0].SeparateScalefactor();
-								Tensor current = std::move(s.second);
-								Scalar scale = std::move(s.first);
-
-								// Remove the first element
-								stack.erase(stack.begin());
-
-								// Iterate over all the other summands
-								for (int i=0; i<stack.size(); i++) {
-									auto t = stack[i].SeparateScalefactor();
-									Tensor newTerm = std::move(t.second);
-									Scalar newScale = std::move(t.first);
-
-									// If the tensor is the same after canonicalization modulo scale,
-									// change the scale of the original tensor and remove the new one
-									// from the stack.
-									if (newTerm.GetType() == current.GetType() && newTerm.GetIndices() == current.GetIndices()) {
-										scale += newScale;
-										stack.erase(stack.begin() + i);
-										i--;
-									}
-								}
-
-								if (!scale.IsNumeric() || scale.ToDouble() != 0) {
-									if (firstEntry) {
-										firstEntry = false;
-										lastScale = scale;
-									}
-
-									if (lastScale != scale && lastScale != -scale) {
-										allTheSameScale = false;
-									}
-									reduced.push_back({ scale, current });
-								}
+						if (reduced.size() > 0) {
+							lastScale = reduced[0].first;
+						}
+
+						for (auto& pair : reduced) {
+							if (lastScale != pair.first && lastScale != -pair.first) {
+								allTheSameScale = false;
+								break;
 							}
 						}
 
@@ -3489,30 +4684,13 @@ namespace Construction {
 						return overalScale * result;
 
                     } else {
-                        std::vector<Tensor> map_keys;
-                        std::vector<scalar_type> map_values;
-
-                        // Iterate over all symmetrized pairs
-						for (auto& pair : symmetrizedSummands) {
+                        // Collect all the symmetrized pairs
+                        std::vector<Tensor> combined;
+                        for (auto& pair : CollectLikeTerms(std::move(symmetrizedSummands))) {
                             // Ignore zeroes
                             if (pair.second.IsZeroTensor()) continue;
 
-                            auto it = std::find_if(map_keys.begin(), map_keys.end(), [&](const Tensor& _tensor) {
-                                return _tensor.ToString() == pair.second.ToString();
-                            });
-
-                            if (it == map_keys.end()) {
-                                map_keys.push_back(pair.second);
-                                map_values.push_back(pair.first);
-                            } else {
-                                map_values[std::distance(map_keys.begin(), it)] += pair.first;
-                            }
-						}
-
-                        // Combine
-                        std::vector<Tensor> combined;
-                        for (int i=0; i<map_keys.size(); ++i) {
-                            combined.push_back(map_keys[i] * map_values[i]);
+                            combined.push_back(pair.first * pair.second);
                         }
 
 						return Tensor::Add(combined);
@@ -3548,6 +4726,101 @@ namespace Construction {
                     return Scalar(1,2) * ( *this + clone ).Canonicalize();
                 }
             }
+
+            /**
+                \brief Block symmetrizes the tensor
+
+                Symmetrizes the tensor under the exchange of the given blocks
+                of indices, where only blocks of the same size are exchanged,
+                and in each of the given sets of indices. Instead of chaining
+                the single symmetrizations, the group generated by all these
+                symmetries is applied in one pass over the summands.
+
+                Sums of epsilon-gamma tensors have a unique canonical form and
+                are decomposed into orbits under the group, see `SymmetrizeOrbits`.
+                For all other tensors the group elements are enumerated, see
+                `SymmetrizeGroup`. The terms with the same coefficient are
+                grouped in the result.
+
+                \param      blocks          The blocks to exchange
+                \param      symmetrized     The sets to symmetrize in
+                \returns    Tensor          The symmetrized tensor
+             */
+            Tensor BlockSymmetrize(const std::vector<Indices>& blocks, const std::vector<Indices>& symmetrized = {}) const {
+                if (IsScaled()) {
+                    auto s = SeparateScalefactor();
+                    return s.first * s.second.BlockSymmetrize(blocks, symmetrized);
+                }
+
+                // Do not waste time on zero tensor
+                if (IsZeroTensor()) return *this;
+
+                // Generate the exchanges of two blocks of the same size
+                std::vector<std::map<Index, Index>> generators;
+
+                for (unsigned i=0; i<blocks.size(); ++i) {
+                    for (unsigned j=i+1; j<blocks.size(); ++j) {
+                        if (blocks[i].Size() != blocks[j].Size()) continue;
+
+                        std::map<Index, Index> mapping;
+                        for (unsigned k=0; k<blocks[i].Size(); ++k) {
+                            mapping[blocks[i][k]] = blocks[j][k];
+                            mapping[blocks[j][k]] = blocks[i][k];
+                        }
+
+                        generators.push_back(std::move(mapping));
+                    }
+                }
+
+                // Generate the transpositions of neighbouring indices in the sets
+                for (auto& set : symmetrized) {
+                    for (unsigned i=0; i+1<set.Size(); ++i) {
+                        generators.push_back({ { set[i], set[i+1] }, { set[i+1], set[i] } });
+                    }
+                }
+
+                if (generators.size() == 0) return *this;
+
+                auto summands = GetSummands();
+
+                // Check if all the summands have a unique canonical form
+                bool unique = std::all_of(summands.begin(), summands.end(), [](const Tensor& summand) {
+                    return summand.SeparateScalefactor().second.IsEpsilonGamma();
+                });
+
+                auto terms = unique ? SymmetrizeOrbits(summands, generators) : SymmetrizeGroup(summands, generators);
+
+                // Group the terms by their scale
+                std::vector<scalar_type> scales;
+                std::vector<std::vector<Tensor>> groups;
+                std::unordered_map<scalar_type, size_t> positions;
+
+                for (auto& pair : terms) {
+                    // Collect the variables in the scale
+                    auto scale = pair.first.HasVariables() ? pair.first.Simplify() : pair.first;
+
+                    // Ignore the terms that cancelled
+                    if (scale.IsNumeric() && scale.ToDouble() == 0) continue;
+
+                    auto it = positions.find(scale);
+
+                    if (it == positions.end()) {
+                        positions.insert({ scale, scales.size() });
+                        scales.push_back(scale);
+                        groups.push_back({ std::move(pair.second) });
+                        continue;
+                    }
+
+                    groups[it->second].push_back(std::move(pair.second));
+                }
+
+                std::vector<Tensor> combined;
+                for (unsigned i=0; i<scales.size(); ++i) {
+                    combined.push_back(scales[i] * Tensor::Add(std::move(groups[i])));
+                }
+
+                return Tensor::Add(std::move(combined));
+            }
         public:
 			void Serialize(std::ostream& os) const override {
 				pointer->Serialize(os);
@@ -3587,10 +4860,105 @@ namespace Construction {
                 return (*pointer)(std::vector<unsigned>());
             }
 
+            /**
+                \brief Evaluate all the components of the tensor
+
+                Returns the components in the order of GetAllIndexCombinations().
+             */
+            inline std::vector<scalar_type> EvaluateAll() const {
+                return pointer->EvaluateAll();
+            }
+
+            /**
+                \brief Evaluate the tensor on a list of index combinations
+
+                Evaluate the tensor on a list of index combinations whose
+                values are given in the order of the indices of the tensor.
+             */
+            inline std::vector<scalar_type> EvaluateColumn(const IndexCombinationTable& combinations) const {
+                return pointer->EvaluateColumn(combinations);
+            }
+
+            /**
+                \brief Evaluate the tensor on a list of index combinations
+
+                Evaluate the tensor on a list of index combinations whose values
+                are given in the order of `indices`. This is the column version of
+                evaluating with an IndexAssignments object.
+             */
+            inline std::vector<scalar_type> EvaluateColumn(const Indices& indices, const IndexCombinationTable& combinations) const {
+                IndexCombinationTable reordered;
+                return pointer->EvaluateColumn(AbstractTensor::ReorderCombinations(indices, pointer->GetIndices(), combinations, reordered));
+            }
+
+            /**
+                \brief Evaluate the non-vanishing components on a list of index combinations
+
+                Like EvaluateColumn, but only returns the positions and values of
+                the non-zero numerical components as fractions, i.e. one sparse
+                column of a matrix.
+             */
+            std::vector<std::pair<unsigned, Construction::Tensor::Fraction>> EvaluateSparseColumn(const Indices& indices, const IndexCombinationTable& combinations) const {
+                auto column = EvaluateColumn(indices, combinations);
+
+                std::vector<std::pair<unsigned, Construction::Tensor::Fraction>> result;
+
+                for (unsigned j=0; j<column.size(); j++) {
+                    auto& s = column[j];
+
+                    Construction::Tensor::Fraction value;
+                    if (s.IsFraction()) {
+                        value = *s.As<Fraction>();
+                    } else if (!s.HasVariables()) {
+                        value = Construction::Tensor::Fraction::FromDouble(s.ToDouble());
+                    } else continue;
+
+                    if (value != Construction::Tensor::Fraction(0)) {
+                        result.push_back({ j, value });
+                    }
+                }
+
+                return result;
+            }
+
 			/** Tensor Arithmetics **/
 			Tensor& operator+=(const Tensor& other) {
-				auto old = std::move(pointer);
-				pointer = std::move(AbstractTensor::Add(*old, *other.pointer));
+				// If one is the zero tensor
+				if (other.IsZeroTensor()) return *this;
+				if (IsZeroTensor()) {
+					pointer = other.pointer;
+					return *this;
+				}
+
+				// Append to the sum in place, sharing the nodes of the other tensor
+				if (IsAdded()) {
+					Detach();
+					auto sum = static_cast<AddedTensor*>(pointer.get());
+
+					if (other.IsAdded()) {
+						// Remember the size, since other might be this very sum
+						auto otherSum = other.As<AddedTensor>();
+						size_t size = otherSum->Size();
+
+						for (unsigned i=0; i<size; ++i) {
+							sum->AddFromRight(otherSum->At(i));
+						}
+					} else {
+						sum->AddFromRight(other.pointer);
+					}
+
+					return *this;
+				}
+
+				// If the other one is a sum, prepend this tensor to a copy of it
+				if (other.IsAdded()) {
+					auto sum = other.pointer->Clone();
+					static_cast<AddedTensor*>(sum.get())->AddFromLeft(pointer);
+					pointer = std::move(sum);
+					return *this;
+				}
+
+				pointer = TensorPointer(new AddedTensor(pointer, other.pointer));
 				return *this;
 			}
 
@@ -3599,9 +4967,7 @@ namespace Construction {
 			}
 
 			Tensor& operator-=(const Tensor& other) {
-				auto old = std::move(pointer);
-				pointer = std::move(AbstractTensor::Add(*old, *AbstractTensor::Multiply(*other.pointer, -1)));
-				return *this;
+				return (*this) += Tensor(AbstractTensor::Multiply(*other.pointer, -1));
 			}
 
 			inline Tensor operator-(const Tensor& other) const {
@@ -3613,8 +4979,7 @@ namespace Construction {
 			}
 
 			Tensor& operator*=(const scalar_type& c) {
-				auto old = std::move(pointer);
-				pointer = std::move(AbstractTensor::Multiply(*old, c));
+				pointer = AbstractTensor::Multiply(*pointer, c);
 				return *this;
 			}
 
@@ -3627,8 +4992,7 @@ namespace Construction {
 			}
 
 			Tensor& operator*=(const Tensor& other) {
-				auto old = std::move(pointer);
-				pointer = std::move(AbstractTensor::Multiply(*old, *other.pointer));
+				pointer = AbstractTensor::Multiply(*pointer, *other.pointer);
 				return *this;
 			}
 
@@ -3647,12 +5011,23 @@ namespace Construction {
 				if (factors.size() == 0) return Tensor::Zero();
                 if (factors.size() == 1) return factors[0];
 
-				std::vector<TensorPointer> pointers;
+				std::vector<ConstTensorPointer> pointers;
+				pointers.reserve(factors.size());
+
 				for (auto& tensor : factors) {
                     // Ignore zeroes
                     if (tensor.IsZeroTensor()) continue;
 
-					pointers.push_back(std::move(tensor.pointer->Clone()));
+                    // Splice sums into the list, such that we always get one flat sum
+                    if (tensor.IsAdded()) {
+                        auto sum = tensor.As<AddedTensor>();
+                        for (unsigned i=0; i<sum->Size(); ++i) {
+                            pointers.push_back(sum->At(i));
+                        }
+                        continue;
+                    }
+
+					pointers.push_back(tensor.pointer);
 				}
 
                 // If there was no non-zero tensor, return zero
@@ -3661,14 +5036,48 @@ namespace Construction {
 				return Tensor(TensorPointer(new AddedTensor(std::move(pointers), factors[0].GetIndices())));
 			}
 
+			/**
+				Same as above, but moves the tensors into the sum instead of sharing them.
+			 */
+		    static Tensor Add(std::vector<Tensor>&& factors) {
+				if (factors.size() == 0) return Tensor::Zero();
+                if (factors.size() == 1) return std::move(factors[0]);
+
+                auto indices = factors[0].GetIndices();
+
+				std::vector<ConstTensorPointer> pointers;
+				pointers.reserve(factors.size());
+
+				for (auto& tensor : factors) {
+                    // Ignore zeroes
+                    if (tensor.IsZeroTensor()) continue;
+
+                    // Splice sums into the list, such that we always get one flat sum
+                    if (tensor.IsAdded()) {
+                        tensor.Detach();
+                        for (auto& summand : static_cast<AddedTensor*>(tensor.pointer.get())->ReleaseSummands()) {
+                            pointers.push_back(std::move(summand));
+                        }
+                        continue;
+                    }
+
+					pointers.push_back(std::move(tensor.pointer));
+				}
+
+                // If there was no non-zero tensor, return zero
+                if (pointers.size() == 0) return Tensor::Zero();
+
+				return Tensor(TensorPointer(new AddedTensor(std::move(pointers), indices)));
+			}
+
 			Tensor ForEachOnSummands(std::function<Tensor(const Tensor&)> fn) const {
 				// Split into the summands
 				auto summands = GetSummands();
 
-                Common::TaskPool pool;
+                auto pool = Parallel::GlobalTaskPool::Instance();
 
 				// Map in parallel
-                std::vector<Tensor> result = pool.MapEmit<Tensor, Tensor>(summands,  [&](const Tensor& tensor, std::function<void(Tensor&&)> emit) -> void {
+                std::vector<Tensor> result = pool->MapEmit<Tensor, Tensor>(summands,  [&](const Tensor& tensor, std::function<void(Tensor&&)> emit) -> void {
                     auto transformed = fn(std::move(tensor));
 
                     if (!transformed.IsZeroTensor()) emit(std::move(transformed));
@@ -3711,7 +5120,7 @@ namespace Construction {
 				}
 			}
 		private:
-			TensorPointer pointer;
+			std::shared_ptr<AbstractTensor> pointer;
 		};
 
 	}
@@ -2,10 +2,15 @@
 
 #include <common/logger.hpp>
 #include <common/error.hpp>
+#include <common/cancellation.hpp>
 #include <vector/vector.hpp>
 
+#include <algorithm>
+#include <cassert>
 #include <iomanip>
+#include <map>
 #include <sstream>
+#include <vector>
 
 namespace Construction {
     namespace Vector {
@@ -70,6 +75,9 @@ namespace Construction {
             bool operator!=(const MatrixIndex& other) const {
                 return (row != other.row) || (column != other.column);
             }
+        public:
+            inline unsigned GetRow() const { return row; }
+            inline unsigned GetColumn() const { return column; }
         private:
             unsigned row;
             unsigned column;
@@ -123,6 +131,58 @@ namespace Construction {
                 }
             }
 
+            /**
+                \brief Assembles a matrix from its sparse columns
+
+                Every column is the list of the rows and values of its entries,
+                e.g. evaluated independently of each other in parallel. The
+                entries are bucketed by their row first, s.t. they can be
+                inserted in the order of the storage in a single pass. Entries
+                of a column with the same row are added up, zeros are not stored.
+
+                \param n        Number of rows
+                \param columns  The entries of every column
+             */
+            Matrix(unsigned n, const std::vector<std::vector<std::pair<unsigned, T>>>& columns) : n(n), m(columns.size()) {
+                // Count the entries in every row
+                std::vector<unsigned> offsets (n+1, 0);
+                for (auto& column : columns) {
+                    for (auto& entry : column) {
+                        assert(entry.first < n);
+                        offsets[entry.first+1]++;
+                    }
+                }
+
+                for (unsigned i=0; i<n; i++) {
+                    offsets[i+1] += offsets[i];
+                }
+
+                // Bucket the entries by row, within a row they are ordered by column
+                std::vector<std::pair<unsigned, const T*>> entries (offsets[n]);
+                for (unsigned j=0; j<m; j++) {
+                    for (auto& entry : columns[j]) {
+                        entries[offsets[entry.first]++] = { j, &entry.second };
+                    }
+                }
+
+                // Insert at the end of the storage, the entries of the same row
+                // and column are next to each other
+                unsigned k = 0;
+                for (unsigned i=0; i<n; i++) {
+                    while (k < offsets[i]) {
+                        unsigned j = entries[k].first;
+
+                        T value = *entries[k].second;
+                        for (k++; k < offsets[i] && entries[k].first == j; k++) {
+                            value = value + *entries[k].second;
+                        }
+
+                        if (value == T(0)) continue;
+                        values.emplace_hint(values.end(), MatrixIndex(i, j), value);
+                    }
+                }
+            }
+
             Matrix(const Matrix& other) : n(other.n), m(other.m), values(other.values) { }
 
             Matrix(Matrix&& other) : n(std::move(other.n)), m(std::move(other.m)), values(std::move(other.values)) { }
@@ -469,6 +529,8 @@ namespace Construction {
                 for (unsigned r=0; r<numRows; ++r) {
                     if (lead >= GetNumberOfColumns()) return;
 
+                    Construction::Common::CancellationToken::Current().ThrowIfCancelled();
+
                     // Search for first line that has a non-zero entry as pivot element
                     unsigned i = r;
                     while (At(i, lead) == T(0)) {
@@ -511,6 +573,106 @@ namespace Construction {
                     Construction::Logger::Debug("Gauss step: ", ToString(false));
                 }
             }
+
+            /**
+                \brief Reduce to the reduced row echelon form row by row
+
+                Reduce the matrix to the reduced row echelon form by streaming
+                over the rows. Every row is reduced against the pivot rows found
+                so far and, if it does not vanish, becomes a new pivot row. The
+                pivot rows are kept densely, which is way cheaper than the
+                updates of the sparse storage for every row in every step.
+
+                If the rank of the matrix is known a-priori, e.g. the number of
+                linear independent invariant tensors, the elimination stops as
+                soon as that many pivots are found. The remaining rows are then
+                linear dependent on the pivot rows and would vanish anyway.
+                The result is the same as the one of ToRowEchelonForm().
+
+                \param      maxRank     The known rank of the matrix or zero if unknown
+                \returns    unsigned    The number of pivot rows
+             */
+            unsigned ToRowEchelonForm(unsigned maxRank) {
+                std::vector<std::vector<T>> pivots;
+                std::vector<unsigned> leads;
+
+                std::vector<T> row (m);
+
+                auto it = values.begin();
+                for (unsigned r=0; r<n && it != values.end(); ++r) {
+                    if (maxRank > 0 && pivots.size() >= maxRank) break;
+
+                    Construction::Common::CancellationToken::Current().ThrowIfCancelled();
+
+                    // Expand the row, the storage is ordered by rows
+                    std::fill(row.begin(), row.end(), T(0));
+                    if (it->first.GetRow() != r) continue;
+
+                    for (; it != values.end() && it->first.GetRow() == r; ++it) {
+                        row[it->first.GetColumn()] = it->second;
+                    }
+
+                    // Reduce against the pivot rows
+                    for (unsigned p=0; p<pivots.size(); ++p) {
+                        T x = row[leads[p]];
+                        if (x == T(0)) continue;
+
+                        for (unsigned k=0; k<m; ++k) {
+                            if (pivots[p][k] == T(0)) continue;
+
+                            // Store zeros as T(0), like Set does
+                            row[k] = row[k] - x * pivots[p][k];
+                            if (row[k] == T(0)) row[k] = T(0);
+                        }
+                    }
+
+                    // Find the new pivot
+                    unsigned lead = 0;
+                    while (lead < m && row[lead] == T(0)) ++lead;
+                    if (lead == m) continue;
+
+                    // Normalize the row
+                    T x = row[lead];
+                    for (unsigned k=lead; k<m; ++k) {
+                        if (row[k] != T(0)) row[k] = row[k] / x;
+                    }
+
+                    // Eliminate the new pivot from the other pivot rows
+                    for (auto& pivot : pivots) {
+                        T y = pivot[lead];
+                        if (y == T(0)) continue;
+
+                        for (unsigned k=lead; k<m; ++k) {
+                            if (row[k] == T(0)) continue;
+
+                            pivot[k] = pivot[k] - y * row[k];
+                            if (pivot[k] == T(0)) pivot[k] = T(0);
+                        }
+                    }
+
+                    pivots.push_back(row);
+                    leads.push_back(lead);
+                }
+
+                // Sort the pivot rows by their leading column
+                std::vector<unsigned> order (pivots.size());
+                for (unsigned i=0; i<order.size(); ++i) order[i] = i;
+
+                std::sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+                    return leads[a] < leads[b];
+                });
+
+                // Write the result back
+                values.clear();
+                for (unsigned i=0; i<order.size(); ++i) {
+                    auto& pivot = pivots[order[i]];
+                    for (unsigned k=0; k<m; ++k) {
+                        if (pivot[k] != T(0)) values.insert({ MatrixIndex(i,k), pivot[k] });
+                    }
+                }
+
+                return pivots.size();
+            }
         public:
             void SwapRows(unsigned i, unsigned j) {
                 assert(i < n && j < n);
@@ -37,7 +37,7 @@ int main(int argc, char** argv) {
     }
 
     // Add options for debugging
-    Construction::Equations::SubstitutionManager::Instance()->SetMaxTickets(1);
+    Construction::Equations::SubstitutionManager::Instance()->SetMaxTickets(0);
 
     if (argc > 2) {
         std::string option = argv[2];
@@ -94,7 +94,7 @@ int main(int argc, char** argv) {
     }
 
     // Calculate number of coefficients and equations
-    int numberOfSteps = equations.size() + 8 * Construction::Equations::Coefficients::Instance()->Size();
+    int numberOfSteps = equations.size() + Construction::Equations::Coefficient::GetNumberOfSteps() * Construction::Equations::Coefficients::Instance()->Size();
 
     // Create progress bar
     Construction::Common::ProgressBar progress (numberOfSteps, 100);
@@ -35,6 +35,15 @@ SCENARIO("API methods", "[api]") {
 			REQUIRE(redefined.ToString() == "e_1 * (\\gamma_{ab}\\gamma_{cd} + \\gamma_{cb}\\gamma_{ad}) + e_2 * \\gamma_{ac}\\gamma_{bd}");
 
 		}
+
+		WHEN(" generating a block symmetric tensor directly") {
+			Construction::Generator::BaseTensorGenerator generator;
+			auto symmetric = generator.Generate(2, 0, 2, 0, true);
+
+			THEN(" only one term per orbit is generated") {
+				REQUIRE(symmetric.ToString() == "e_1 * \\gamma_{ab}\\gamma_{cd} + \n1/2 * e_2 * (\\gamma_{ac}\\gamma_{bd} + \\gamma_{ad}\\gamma_{bc})");
+			}
+		}
 	}
 
 	GIVEN(" five indices") {
@@ -58,6 +67,13 @@ SCENARIO("API methods", "[api]") {
 				REQUIRE(redefined.ToString() == "e_1 * \\epsilon_{abc}\\gamma_{de} + e_2 * \\epsilon_{abd}\\gamma_{ce} + e_3 * \\epsilon_{abe}\\gamma_{cd} + e_4 * \\epsilon_{acd}\\gamma_{be} + e_5 * \\epsilon_{ace}\\gamma_{bd} + e_6 * \\epsilon_{ade}\\gamma_{bc}");
 			}
 
+			THEN(" the degrees of freedom are known a-priori") {
+				REQUIRE(Construction::Generator::InvariantDimension::Compute(5) == 6);
+				REQUIRE(Construction::Language::API::ExpectedRank(arbitrary) == 6);
+				REQUIRE(Construction::Language::API::DegreesOfFreedom(arbitrary) == 6);
+				REQUIRE(Construction::Generator::InvariantDimension::Compute(2, 1, 2, 1, true) == 5);
+			}
+
 		}
 
 	}
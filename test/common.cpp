@@ -1,2 +1,5 @@
 #include "common/range.cpp"
-#include "common/time_measurement.hpp"
\ No newline at end of file
+#include "common/time_measurement.hpp"
+#include "common/task_pool.cpp"
+#include "common/job_scheduler.cpp"
+#include "common/cancellation.cpp"
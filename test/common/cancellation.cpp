@@ -0,0 +1,125 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <common/cancellation.hpp>
+#include <common/task_pool.hpp>
+
+SCENARIO("Cancellation token", "[cancellation]") {
+    using Construction::Common::CancellationToken;
+    using Construction::Common::CancellationScope;
+    using Construction::Common::OperationCancelledException;
+
+    GIVEN(" a default token") {
+        CancellationToken token;
+
+        THEN(" it is never cancelled") {
+            token.Cancel();
+
+            REQUIRE(!token.IsCancelled());
+            REQUIRE_NOTHROW(token.ThrowIfCancelled());
+        }
+    }
+
+    GIVEN(" a token without budget") {
+        auto token = CancellationToken::Create();
+
+        THEN(" it is only cancelled by hand") {
+            REQUIRE(!token.IsCancelled());
+
+            auto copy = token;
+            copy.Cancel();
+
+            REQUIRE(token.IsCancelled());
+            REQUIRE_THROWS_AS(token.ThrowIfCancelled(), OperationCancelledException);
+        }
+
+        THEN(" the children are cancelled with it") {
+            auto child = CancellationToken::Create(std::chrono::milliseconds(0), 0, token);
+
+            REQUIRE(!child.IsCancelled());
+            token.Cancel();
+            REQUIRE(child.IsCancelled());
+        }
+    }
+
+    GIVEN(" a shared token") {
+        auto shared = CancellationToken::CreateShared();
+
+        auto first = CancellationToken::Create();
+        auto second = CancellationToken::Create();
+
+        REQUIRE(shared.Join(first));
+        REQUIRE(shared.Join(second));
+
+        THEN(" it is only cancelled once all the joined tokens are cancelled") {
+            first.Cancel();
+            REQUIRE(!shared.IsCancelled());
+
+            second.Cancel();
+            REQUIRE(shared.IsCancelled());
+
+            REQUIRE(!shared.Join(CancellationToken::Create()));
+        }
+    }
+
+    GIVEN(" a token with a time limit") {
+        auto token = CancellationToken::Create(std::chrono::milliseconds(10));
+
+        THEN(" it is cancelled once the time is up") {
+            REQUIRE(!token.IsCancelled());
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+            REQUIRE(token.IsCancelled());
+        }
+    }
+
+#ifdef __linux__
+    GIVEN(" a token with a memory limit") {
+        auto token = CancellationToken::Create(std::chrono::milliseconds(0), 16);
+
+        THEN(" only the memory allocated after its creation counts") {
+            REQUIRE(!token.IsCancelled());
+
+            // Touch every page, s.t. it becomes resident
+            std::vector<char> memory (64 * 1024 * 1024, 1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+            REQUIRE(memory.back() == 1);
+            REQUIRE(token.IsCancelled());
+
+            auto later = CancellationToken::Create(std::chrono::milliseconds(0), 16);
+            REQUIRE(!later.IsCancelled());
+        }
+    }
+#endif
+
+    GIVEN(" a cancelled token of the current thread") {
+        auto token = CancellationToken::Create();
+        token.Cancel();
+
+        Construction::Common::TaskPool pool (2);
+
+        THEN(" the parallel loops of the pool stop with an exception") {
+            std::atomic<unsigned> calls (0);
+
+            CancellationScope scope (token);
+
+            REQUIRE_THROWS_AS(pool.ParallelFor(0, 100, [&](size_t) { ++calls; }, 1), OperationCancelledException);
+            REQUIRE(calls.load() == 0);
+        }
+
+        THEN(" other threads are not affected") {
+            {
+                CancellationScope scope (token);
+            }
+
+            std::atomic<unsigned> calls (0);
+            pool.ParallelFor(0, 100, [&](size_t) { ++calls; }, 1);
+
+            REQUIRE(calls.load() == 100);
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#include <future>
+#include <vector>
+
+#include <common/job_scheduler.hpp>
+
+SCENARIO("Job scheduler", "[job-scheduler]") {
+
+    GIVEN(" a scheduler with a single thread") {
+
+        Construction::Common::JobScheduler scheduler(1);
+
+        WHEN(" submitting jobs while the thread is busy") {
+            std::promise<void> release;
+            auto blocker = release.get_future().share();
+
+            std::vector<int> order;
+
+            auto first = scheduler.Submit([blocker]() { blocker.wait(); });
+
+            std::vector<std::future<void>> jobs;
+            for (int priority : { 1, 3, 2, 3 }) {
+                jobs.push_back(scheduler.Submit([&order, priority]() { order.push_back(priority); }, priority));
+            }
+
+            release.set_value();
+
+            first.wait();
+            for (auto& job : jobs) job.wait();
+
+            THEN(" they are started by priority") {
+                REQUIRE(order == std::vector<int>({ 3, 3, 2, 1 }));
+            }
+        }
+
+        WHEN(" a job throws") {
+            auto job = scheduler.Submit([]() { throw std::runtime_error("fail"); });
+
+            THEN(" the exception is passed to the future") {
+                REQUIRE_THROWS_AS(job.get(), std::runtime_error);
+            }
+        }
+    }
+
+}
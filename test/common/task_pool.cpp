@@ -0,0 +1,112 @@
+#include <common/task_pool.hpp>
+
+SCENARIO("Task pool", "[task-pool]") {
+
+    GIVEN(" a pool with four workers") {
+
+        Construction::Common::TaskPool pool(4);
+
+        WHEN(" enqueueing many small tasks") {
+            std::atomic<long> sum(0);
+
+            for (int i=0; i<10000; i++) {
+                pool.Enqueue([&sum](int x) { sum += x; }, i);
+            }
+
+            pool.Wait();
+
+            THEN(" all of them are executed") {
+                REQUIRE(sum == 10000L * 9999 / 2);
+                REQUIRE(pool.Empty());
+            }
+        }
+
+        WHEN(" the tasks wait for their own subtasks") {
+            std::atomic<int> count(0);
+
+            for (int i=0; i<16; i++) {
+                pool.Enqueue([&]() {
+                    for (int j=0; j<100; j++) {
+                        pool.Enqueue([&count]() { count++; });
+                    }
+
+                    pool.Wait();
+                });
+            }
+
+            pool.Wait();
+
+            THEN(" the pool does not block") {
+                REQUIRE(count == 1600);
+            }
+        }
+
+        WHEN(" mapping a list") {
+            std::vector<int> elements;
+            for (int i=0; i<1000; i++) elements.push_back(i);
+
+            auto result = pool.Map<int, int>(elements, [](const int& x) { return 2*x; });
+
+            THEN(" the results are in order") {
+                REQUIRE(result.size() == 1000);
+                for (int i=0; i<1000; i++) {
+                    REQUIRE(result[i] == 2*i);
+                }
+                REQUIRE(pool.Enqueue([]() { return 42; }).get() == 42);
+            }
+        }
+
+        WHEN(" looping and reducing over a range in chunks") {
+            std::vector<int> values (1000, 0);
+
+            pool.ParallelFor(0, values.size(), [&values](size_t i) {
+                values[i] = i;
+            }, 7);
+
+            auto sum = pool.ParallelReduce<long>(0, values.size(), 0, [&values](size_t i) -> long {
+                return values[i];
+            }, [](long a, long b) { return a + b; });
+
+            THEN(" every index is visited once") {
+                for (int i=0; i<1000; i++) {
+                    REQUIRE(values[i] == i);
+                }
+                REQUIRE(sum == 1000L * 999 / 2);
+            }
+        }
+
+        WHEN(" a call inside of a loop throws") {
+            THEN(" the exception is passed to the caller") {
+                REQUIRE_THROWS_AS(pool.ParallelFor(0, 100, [](size_t i) {
+                    if (i == 50) throw std::runtime_error("fail");
+                }, 1), std::runtime_error);
+            }
+        }
+    }
+
+    GIVEN(" the global task pool") {
+
+        auto pool = Construction::Parallel::GlobalTaskPool::Instance();
+
+        WHEN(" mapping inside of a map") {
+            std::vector<int> elements;
+            for (int i=0; i<64; i++) elements.push_back(i);
+
+            auto result = pool->Map<int, int>(elements, [&](const int& x) {
+                auto inner = pool->Map<int, int>(elements, [x](const int& y) { return x*y; });
+
+                int sum = 0;
+                for (auto& v : inner) sum += v;
+                return sum;
+            });
+
+            THEN(" the nested calls do not block the workers") {
+                REQUIRE(result.size() == 64);
+                for (int i=0; i<64; i++) {
+                    REQUIRE(result[i] == i * 64 * 63 / 2);
+                }
+            }
+        }
+    }
+
+}
@@ -0,0 +1,149 @@
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include <equations/coefficient_stages.hpp>
+
+SCENARIO("Coefficient stages", "[coefficient-stages]") {
+    using Construction::Equations::CoefficientStages;
+
+    auto stages = CoefficientStages::Instance();
+    auto gamma = Construction::Tensor::Tensor::Gamma(Construction::Tensor::Indices::GetRomanSeries(2, {1,3}));
+
+    GIVEN(" a stage requested several times") {
+        std::atomic<unsigned> calls (0);
+
+        auto fn = [&]() {
+            ++calls;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return gamma;
+        };
+
+        auto first = stages->Stage("test-shared", fn);
+        auto second = stages->Stage("test-shared", fn);
+
+        THEN(" it is calculated once and the result is shared") {
+            REQUIRE(first.get().ToString() == gamma.ToString());
+            REQUIRE(second.get().ToString() == gamma.ToString());
+            REQUIRE(calls.load() == 1);
+        }
+    }
+
+    GIVEN(" a stage that depends on another one") {
+        std::atomic<bool> parentFinished (false);
+        std::atomic<bool> ranAfterParent (false);
+
+        stages->Stage("test-parent", [&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            parentFinished.store(true);
+            return gamma;
+        });
+
+        auto result = stages->Stage("test-child", "test-parent", [&](const Construction::Tensor::Tensor& tensor) {
+            ranAfterParent.store(parentFinished.load());
+            return tensor * Construction::Tensor::Scalar(2);
+        });
+
+        THEN(" it runs on the result of the other one once it is finished") {
+            REQUIRE(result.get().ToString() == (gamma * Construction::Tensor::Scalar(2)).ToString());
+            REQUIRE(ranAfterParent.load());
+        }
+    }
+
+    GIVEN(" a stage that fails") {
+        auto first = stages->Stage("test-failing", []() -> Construction::Tensor::Tensor {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            throw std::runtime_error("failed");
+        });
+        auto second = stages->Stage("test-failing", [&]() { return gamma; });
+
+        auto dependent = stages->Stage("test-failing-child", "test-failing", [](const Construction::Tensor::Tensor& tensor) {
+            return tensor;
+        });
+
+        THEN(" every sharer and every dependent stage gets the exception") {
+            REQUIRE_THROWS_AS(first.get(), std::runtime_error);
+            REQUIRE_THROWS_AS(second.get(), std::runtime_error);
+            REQUIRE_THROWS_AS(dependent.get(), std::runtime_error);
+        }
+    }
+
+    GIVEN(" a stage that polls the cancellation") {
+        using Construction::Common::CancellationToken;
+        using Construction::Common::CancellationScope;
+        using Construction::Common::OperationCancelledException;
+
+        std::atomic<unsigned> calls (0);
+
+        auto fn = [&]() {
+            ++calls;
+
+            for (int i=0; i<200; i++) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                CancellationToken::Current().ThrowIfCancelled();
+            }
+
+            return gamma;
+        };
+
+        auto token = CancellationToken::Create();
+        auto other = CancellationToken::Create();
+
+        WHEN(" its only requester is cancelled") {
+            CoefficientStages::Result first;
+
+            {
+                CancellationScope scope (token);
+                first = stages->Stage("test-cancelled", fn);
+
+                while (calls.load() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                token.Cancel();
+
+                REQUIRE_THROWS_AS(CoefficientStages::Wait(first), OperationCancelledException);
+            }
+
+            THEN(" the stage stops and the next request calculates it anew") {
+                REQUIRE_THROWS_AS(first.get(), OperationCancelledException);
+
+                CancellationScope scope (other);
+                auto second = stages->Stage("test-cancelled", fn);
+
+                REQUIRE(second.get().ToString() == gamma.ToString());
+                REQUIRE(calls.load() == 2);
+            }
+        }
+
+        WHEN(" another requester is not cancelled") {
+            CoefficientStages::Result first, second;
+
+            {
+                CancellationScope scope (token);
+                first = stages->Stage("test-cancelled-shared", fn);
+            }
+
+            {
+                CancellationScope scope (other);
+                second = stages->Stage("test-cancelled-shared", fn);
+            }
+
+            token.Cancel();
+
+            THEN(" the stage goes on for the other one") {
+                REQUIRE(second.get().ToString() == gamma.ToString());
+                REQUIRE(calls.load() == 1);
+            }
+        }
+    }
+
+    GIVEN(" a stage with an unknown dependency") {
+        auto fn = [](const Construction::Tensor::Tensor& tensor) { return tensor; };
+
+        THEN(" it throws and is not registered") {
+            REQUIRE_THROWS_AS(stages->Stage("test-orphan", "test-unknown", fn), std::runtime_error);
+
+            auto result = stages->Stage("test-orphan", [&]() { return gamma; });
+            REQUIRE(result.get().ToString() == gamma.ToString());
+        }
+    }
+}
@@ -0,0 +1,136 @@
+#include <memory>
+#include <vector>
+
+#include <equations/equations.hpp>
+
+SCENARIO("Substitution manager", "[substitution-manager]") {
+    using Construction::Equations::Coefficient;
+    using Construction::Equations::CoefficientReference;
+    using Construction::Equations::SubstitutionManager;
+
+    typedef std::shared_ptr<SubstitutionManager::Ticket> TicketReference;
+
+    auto manager = SubstitutionManager::Instance();
+
+    // Every run gets its own variables, s.t. the coefficients of the previous runs
+    // that are still in the index of the manager do not share any with the new ones
+    auto prefix = Coefficient::GetRandomString(6);
+    auto var = [&](const std::string& name) {
+        return Construction::Tensor::Scalar::Variable(prefix + name);
+    };
+
+    // Scalar coefficients are calculated right away, the tensor is replaced afterwards
+    auto coefficient = [](const Construction::Tensor::Scalar& scale) {
+        auto ref = std::make_shared<Coefficient>(0,0,0,0, "test");
+        ref->Start();
+        ref->Wait();
+        ref->SetTensor(scale * Construction::Tensor::Tensor::One());
+        return ref;
+    };
+
+    // c1 and c2 share the variable x, c3 and c4 are independent
+    auto c1 = coefficient(var("x"));
+    auto c2 = coefficient(var("x") + var("y"));
+    auto c3 = coefficient(var("z"));
+    auto c4 = coefficient(var("w"));
+
+    // The tickets in the order they were issued
+    std::vector<std::pair<int, TicketReference>> issued;
+    auto request = [&](int id, const std::vector<CoefficientReference>& coefficients) {
+        manager->RequestTicket(coefficients, [&issued, id](TicketReference ticket) {
+            issued.push_back({ id, ticket });
+        });
+    };
+
+    GIVEN(" equations with disjoint coefficients") {
+        request(1, { c1 });
+        request(2, { c3 });
+        request(3, { c4 });
+
+        THEN(" all of them get a ticket at the same time") {
+            REQUIRE(issued.size() == 3);
+
+            for (auto& pair : issued) pair.second->Release();
+        }
+    }
+
+    GIVEN(" equations with overlapping claims") {
+        request(1, { c3 });
+        request(2, { c2, c3 });
+        request(3, { c1 });
+
+        THEN(" they are served in the order of their requests") {
+            // The second one waits for c3, the third one shares x with the second
+            // one and must not overtake it, although c1 and c2 are not claimed
+            REQUIRE(issued.size() == 1);
+            REQUIRE(issued[0].first == 1);
+
+            issued[0].second->Release();
+
+            REQUIRE(issued.size() == 2);
+            REQUIRE(issued[1].first == 2);
+
+            issued[1].second->Release();
+
+            REQUIRE(issued.size() == 3);
+            REQUIRE(issued[2].first == 3);
+
+            issued[2].second->Release();
+        }
+    }
+
+    GIVEN(" a substitution of a variable") {
+        request(1, { c1, c3 });
+        REQUIRE(issued.size() == 1);
+
+        auto tensorOfC3 = c3->GetAsync();
+        issued[0].second->Fulfill(Construction::Tensor::Substitution(var("x"), var("u")));
+
+        THEN(" only the coefficients that contain it are updated") {
+            REQUIRE(c1->GetVariables() == std::vector<Construction::Tensor::Scalar>({ var("u") }));
+            REQUIRE(c3->GetAsync() == tensorOfC3);
+        }
+
+        THEN(" the index follows the new variables") {
+            // c1 now shares u with c5, but no longer x with c6
+            auto c5 = coefficient(var("u"));
+            auto c6 = coefficient(var("x"));
+
+            request(2, { c1 });
+            request(3, { c5 });
+            request(4, { c6 });
+
+            REQUIRE(issued.size() == 3);
+            REQUIRE(issued[1].first == 2);
+            REQUIRE(issued[2].first == 4);
+
+            issued[1].second->Release();
+
+            REQUIRE(issued.size() == 4);
+            REQUIRE(issued[3].first == 3);
+
+            issued[2].second->Release();
+            issued[3].second->Release();
+        }
+    }
+
+    GIVEN(" a limit on the number of tickets") {
+        manager->SetMaxTickets(1);
+
+        request(1, { c1 });
+        request(2, { c3 });
+
+        THEN(" only that many equations are solved at the same time") {
+            REQUIRE(issued.size() == 1);
+
+            issued[0].second->Release();
+
+            REQUIRE(issued.size() == 2);
+            REQUIRE(issued[1].first == 2);
+
+            issued[1].second->Release();
+        }
+
+        manager->SetMaxTickets(4);
+    }
+}
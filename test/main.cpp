@@ -1,4 +1,5 @@
 #define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_COUNTER
 #include <catch.hpp>
 
 //#include "common.cpp"
@@ -6,4 +7,10 @@
 //#include "api.cpp"
 //#include "vector.cpp"
 
-#include "equations/metric.cpp"
\ No newline at end of file
+#include "common/task_pool.cpp"
+#include "common/job_scheduler.cpp"
+#include "common/cancellation.cpp"
+
+#include "equations/metric.cpp"
+#include "equations/coefficient_stages.cpp"
+#include "equations/substitution_manager.cpp"
@@ -15,3 +15,29 @@ SCENARIO("Simplification", "[simplification]") {
         }
     }
 }
+
+SCENARIO("Fast simplification", "[simplification]") {
+
+    GIVEN(" a sum with like terms") {
+        auto gamma = Construction::Tensor::Tensor::Gamma(Construction::Tensor::Indices::GetRomanSeries(2, {1,3}));
+        auto permuted = Construction::Tensor::Tensor::Gamma({ { "b", {1,3} }, { "a", {1,3} } });
+        auto x = Construction::Tensor::Scalar::Variable("x");
+        auto y = Construction::Tensor::Scalar::Variable("y");
+
+        auto tensor = x * gamma + y * permuted + y * gamma;
+
+        WHEN(" comparing the structure of the terms") {
+            THEN(" identical terms have the same hash") {
+                REQUIRE(gamma.IsIdentical(Construction::Tensor::Tensor::Gamma(Construction::Tensor::Indices::GetRomanSeries(2, {1,3}))));
+                REQUIRE(gamma.Hash() == Construction::Tensor::Tensor::Gamma(Construction::Tensor::Indices::GetRomanSeries(2, {1,3})).Hash());
+                REQUIRE(!gamma.IsIdentical(permuted));
+            }
+        }
+
+        WHEN(" calling FastSimplify") {
+            THEN(" the like terms are collected") {
+                REQUIRE(tensor.FastSimplify().ToString() == "(x + y + y) * \\gamma_{ab}");
+            }
+        }
+    }
+}
@@ -28,6 +28,126 @@ SCENARIO("General tensors", "[tensor]") {
             REQUIRE(tensor.Symmetrize({ {"a", {1,3}}, {"c", {1,3}} }).ToString() == "1/2 * (\\gamma_{ab}\\gamma_{cd} + \\gamma_{ad}\\gamma_{bc})");
         }
 
+        WHEN(" symmetrizing an epsilon-gamma tensor") {
+            auto indices = Construction::Tensor::Indices::GetRomanSeries(7, {1,3});
+            auto tensor = Construction::Tensor::Tensor::EpsilonGamma(1,2, indices);
+            auto gammas = Construction::Tensor::Tensor::EpsilonGamma(0,3, Construction::Tensor::Indices::GetRomanSeries(6, {1,3}));
+
+            THEN(" two indices on the epsilon give zero") {
+                REQUIRE(tensor.Symmetrize({ indices[0], indices[1] }).IsZeroTensor());
+            }
+
+            THEN(" one index on each of two epsilons does not give zero") {
+                auto epsilons = Construction::Tensor::Tensor::EpsilonGamma(2,0, Construction::Tensor::Indices::GetRomanSeries(6, {1,3}));
+                auto symmetrized = epsilons.Symmetrize({ indices[0], indices[3] });
+
+                REQUIRE(!symmetrized.IsZeroTensor());
+                REQUIRE(symmetrized(1, 2, 3, 1, 2, 3) == Construction::Tensor::Scalar(1));
+            }
+
+            THEN(" only the inequivalent terms are generated") {
+                auto symmetrized = gammas.Symmetrize(Construction::Tensor::Indices::GetRomanSeries(6, {1,3}));
+
+                REQUIRE(symmetrized.SeparateScalefactor().first == Construction::Tensor::Scalar(1,15));
+                REQUIRE(symmetrized.SeparateScalefactor().second.GetSummands().size() == 15);
+                REQUIRE(tensor.Symmetrize({ indices[3], indices[4], indices[5], indices[6] }).ToString() == "1/3 * (\\epsilon_{abc}\\gamma_{de}\\gamma_{fg} + \\epsilon_{abc}\\gamma_{df}\\gamma_{eg} + \\epsilon_{abc}\\gamma_{dg}\\gamma_{ef})");
+            }
+        }
+
+        WHEN(" symmetrizing a sum") {
+            auto indices = Construction::Tensor::Indices::GetRomanSeries(4, {1,3});
+            auto first = Construction::Tensor::Tensor::EpsilonGamma(0,2, indices);
+            auto second = Construction::Tensor::Tensor::EpsilonGamma(0,2, { indices[0], indices[2], indices[1], indices[3] });
+
+            THEN(" the like terms are collected") {
+                REQUIRE((first + second).Symmetrize(indices).ToString() == "2/3 * (\\gamma_{ab}\\gamma_{cd} + \\gamma_{ac}\\gamma_{bd} + \\gamma_{ad}\\gamma_{bc})");
+                REQUIRE((first + second).AntiSymmetrize({ indices[0], indices[1] }).ToString() == "1/2 * (\\gamma_{ac}\\gamma_{bd} - \\gamma_{ad}\\gamma_{bc})");
+                REQUIRE((first - second).Symmetrize({ indices[1], indices[2] }).IsZeroTensor());
+            }
+        }
+
+        WHEN(" canonicalizing an epsilon-gamma tensor with contracted indices") {
+            Construction::Tensor::Indices A = { {"a", {1,3}}, {"b", {1,3}}, {"b", {1,3}}, {"c", {1,3}} };
+            Construction::Tensor::Indices B = { {"c", {1,3}}, {"d", {1,3}}, {"d", {1,3}}, {"a", {1,3}} };
+            Construction::Tensor::Indices C = { {"a", {1,3}}, {"b", {1,3}}, {"c", {1,3}}, {"b", {1,3}}, {"c", {1,3}} };
+            A[2].SetContravariant(true);
+            B[1].SetContravariant(true);
+            C[3].SetContravariant(true);
+            C[4].SetContravariant(true);
+
+            auto first = Construction::Tensor::Tensor::EpsilonGamma(0,2, A);
+            auto second = Construction::Tensor::Tensor::EpsilonGamma(0,2, B);
+
+            THEN(" the names and positions of the dummies do not matter") {
+                REQUIRE(first.Canonicalize().ToString() == "\\gamma_{ab}\\gamma^{b}_{c}");
+                REQUIRE(second.Canonicalize().ToString() == "\\gamma_{ab}\\gamma^{b}_{c}");
+                REQUIRE((first - second).FastSimplify().IsZeroTensor());
+            }
+
+            THEN(" an epsilon contracted with a gamma vanishes") {
+                REQUIRE(Construction::Tensor::Tensor::EpsilonGamma(1,1, C).Canonicalize().IsZeroTensor());
+            }
+
+            THEN(" every dummy keeps its own range") {
+                Construction::Tensor::Indices D = { {"b", {1,3}}, {"a", {0,3}}, {"b", {1,3}}, {"a", {0,3}} };
+                D[2].SetContravariant(true);
+                D[3].SetContravariant(true);
+
+                auto canonical = Construction::Tensor::Tensor::EpsilonGamma(0,2, D).Canonicalize().GetIndices();
+
+                unsigned numSpacetime = 0;
+                for (auto& index : canonical) {
+                    for (auto& other : canonical) {
+                        if (index == other) REQUIRE(index.GetRange() == other.GetRange());
+                    }
+
+                    if (index.GetRange() == Construction::Common::Range(0,3)) ++numSpacetime;
+                }
+
+                REQUIRE(numSpacetime == 2);
+            }
+
+            THEN(" the names of mixed Roman and Greek dummies do not matter") {
+                auto greek = Construction::Tensor::Indices::GetGreekSeries(3, {0,3});
+
+                Construction::Tensor::Indices E = { {"b", {1,3}}, greek[1], {"b", {1,3}}, greek[1] };
+                Construction::Tensor::Indices F = { {"c", {1,3}}, greek[2], {"c", {1,3}}, greek[2] };
+                E[2].SetContravariant(true);
+                E[3].SetContravariant(true);
+                F[2].SetContravariant(true);
+                F[3].SetContravariant(true);
+
+                auto canonicalE = Construction::Tensor::Tensor::EpsilonGamma(0,2, E).Canonicalize();
+                auto canonicalF = Construction::Tensor::Tensor::EpsilonGamma(0,2, F).Canonicalize();
+
+                REQUIRE(canonicalE.ToString() == canonicalF.ToString());
+                REQUIRE(canonicalE.GetIndices()[0].IsRomanIndex() != canonicalE.GetIndices()[1].IsRomanIndex());
+            }
+        }
+
+        WHEN(" block symmetrizing a sum") {
+            auto indices = Construction::Tensor::Indices::GetRomanSeries(4, {1,3});
+            auto first = Construction::Tensor::Tensor::EpsilonGamma(0,2, indices);
+            auto second = Construction::Tensor::Tensor::EpsilonGamma(0,2, { indices[0], indices[2], indices[1], indices[3] });
+            auto epsilon = Construction::Tensor::Tensor::EpsilonGamma(1,1, Construction::Tensor::Indices::GetRomanSeries(5, {1,3}));
+
+            Construction::Tensor::Indices left = { indices[0], indices[1] };
+            Construction::Tensor::Indices right = { indices[2], indices[3] };
+
+            THEN(" the blocks and the sets are symmetrized in one pass") {
+                REQUIRE((first + second).BlockSymmetrize({ left, right }).ToString() == "\\gamma_{ab}\\gamma_{cd} + \\gamma_{ac}\\gamma_{bd}");
+                REQUIRE((first + second).BlockSymmetrize({}, { left }).ToString() == "\\gamma_{ab}\\gamma_{cd} + 1/2 * (\\gamma_{ac}\\gamma_{bd} + \\gamma_{ad}\\gamma_{bc})");
+                REQUIRE(epsilon.BlockSymmetrize({}, { left }).IsZeroTensor());
+            }
+
+            THEN(" it agrees with the chained symmetrizations") {
+                auto blocks = (first + 2 * second).BlockSymmetrize({ { indices[0] }, { indices[1] }, { indices[2] }, { indices[3] } });
+
+                REQUIRE(blocks.SeparateScalefactor().first == (first + 2 * second).Symmetrize(indices).SeparateScalefactor().first);
+                REQUIRE(blocks.SeparateScalefactor().second.GetSummands().size() == 3);
+            }
+        }
+
         WHEN(" evaluating the tensor components") {
 
             std::array<double, 9> components;
@@ -50,6 +170,21 @@ SCENARIO("General tensors", "[tensor]") {
 
         }
 
+        WHEN(" copying the tensor and modifying the copy") {
+            auto sum = T + Construction::Tensor::Tensor::Gamma(Construction::Tensor::Indices::GetRomanSeries(2, {1,3}));
+            auto renamed = sum;
+            auto extended = sum;
+
+            renamed.SetIndices(Construction::Tensor::Indices::GetRomanSeries(2, {1,3}, 2));
+            extended += T;
+
+            THEN(" the original tensor is unchanged") {
+                REQUIRE(sum.ToString() == "T_{ab} + \\gamma_{ab}");
+                REQUIRE(renamed.ToString() == "T_{cd} + \\gamma_{cd}");
+                REQUIRE(extended.ToString() == "T_{ab} + \\gamma_{ab} + T_{ab}");
+            }
+        }
+
         WHEN(" serializing the tensor") {
 
             std::stringstream ss;
@@ -349,6 +484,85 @@ SCENARIO("Addition", "[tensor-addition]") {
             }
         }
 
+        WHEN(" simplifying the Schouten identity") {
+            auto term = [](const std::string& a, const std::string& b, const std::string& c, const std::string& d, const std::string& e) {
+                return Construction::Tensor::Tensor::Epsilon({ { a, {1,3} }, { b, {1,3} }, { c, {1,3} } }) * Construction::Tensor::Tensor::Gamma({ { d, {1,3} }, { e, {1,3} } });
+            };
+
+            auto identity = term("a","b","c","d","e") - term("d","b","c","a","e") - term("a","d","c","b","e") - term("a","b","d","c","e");
+            auto independent = term("a","b","c","d","e") + term("a","b","d","c","e");
+
+            THEN(" the contractions show that it vanishes") {
+                REQUIRE(identity.Simplify().IsZeroTensor());
+                REQUIRE(independent.Simplify().GetSummands().size() == 2);
+
+                auto x = Construction::Tensor::Scalar::Variable("x");
+                auto simplified = (identity + x * term("a","b","d","c","e")).Simplify();
+                REQUIRE((simplified - x * (term("a","b","c","d","e") - term("d","b","c","a","e") - term("a","d","c","b","e"))).Simplify().IsZeroTensor());
+            }
+        }
+
+        WHEN(" simplifying with a known symmetry") {
+            auto eta = [](const std::string& a, const std::string& b) {
+                return Construction::Tensor::Tensor::Gamma({ { a, {0,3} }, { b, {0,3} } }, 1, 3);
+            };
+
+            auto x = Construction::Tensor::Scalar::Variable("x");
+            auto y = Construction::Tensor::Scalar::Variable("y");
+            auto sum = x * eta("a","b") * eta("c","d") + y * (eta("a","c") * eta("b","d") + eta("a","d") * eta("b","c")) + 2 * eta("a","b") * eta("c","d");
+
+            Construction::Tensor::Symmetry symmetry;
+            symmetry.Add(Construction::Tensor::ElementarySymmetry(std::vector<unsigned>({ 0, 1 })));
+            symmetry.Add(Construction::Tensor::ElementarySymmetry(std::vector<unsigned>({ 2, 3 })));
+            symmetry.Add(Construction::Tensor::ElementarySymmetry(std::vector<std::vector<unsigned>>({ { 0, 1 }, { 2, 3 } })));
+
+            THEN(" only the canonical components are evaluated") {
+                REQUIRE(symmetry.GetIndexCombinationTable(sum.GetIndices())->Size() == 55);
+                REQUIRE(sum.ToHomogeneousLinearSystem(symmetry).first.GetNumberOfRows() == 55);
+                REQUIRE(sum.Simplify(0, symmetry).ToString() == sum.Simplify().ToString());
+            }
+        }
+
+        WHEN(" building the linear system from sparse columns") {
+            auto x = Construction::Tensor::Scalar::Variable("x");
+            auto y = Construction::Tensor::Scalar::Variable("y");
+            auto sum = x * gamma + y * 2 * Construction::Tensor::Tensor::Gamma({ { "b", {1,3} }, { "a", {1,3} } });
+
+            auto system = sum.ToHomogeneousLinearSystem();
+            auto& M = system.first;
+
+            unsigned cx = (system.second[0] == x) ? 0 : 1;
+            unsigned cy = 1 - cx;
+
+            THEN(" only the diagonal components are filled") {
+                REQUIRE(M.GetNumberOfRows() == 9);
+                REQUIRE(M.GetNumberOfColumns() == 2);
+
+                for (unsigned i=0; i<9; ++i) {
+                    bool diagonal = (i % 4 == 0);
+
+                    REQUIRE(M.At(i, cx) == Construction::Tensor::Fraction(diagonal ? 1 : 0));
+                    REQUIRE(M.At(i, cy) == Construction::Tensor::Fraction(diagonal ? 2 : 0));
+                }
+            }
+
+            THEN(" entries of the same row are added up and zeros are dropped") {
+                typedef std::pair<unsigned, Construction::Tensor::Fraction> Entry;
+
+                Construction::Vector::Matrix<Construction::Tensor::Fraction> N (3, std::vector<std::vector<Entry>>({
+                    { Entry(0, 1), Entry(2, 0), Entry(0, 2) },
+                    { Entry(1, -1), Entry(2, 1), Entry(2, -1) }
+                }));
+
+                REQUIRE(N.At(0, 0) == Construction::Tensor::Fraction(3));
+                REQUIRE(N.At(1, 0) == Construction::Tensor::Fraction(0));
+                REQUIRE(N.At(2, 0) == Construction::Tensor::Fraction(0));
+                REQUIRE(N.At(1, 1) == Construction::Tensor::Fraction(-1));
+                REQUIRE(N.At(2, 1) == Construction::Tensor::Fraction(0));
+                REQUIRE(N.ToRowEchelonForm(0) == 2);
+            }
+        }
+
         WHEN(" symmetrizing (manually)") {
             Construction::Tensor::Indices indices = { {"b", {1,3}}, {"a", {1,3}} };
             auto permuted_gamma = Construction::Tensor::Tensor::Gamma({ { "b", {1,3} }, { "a", {1,3} } });
@@ -457,6 +671,30 @@ SCENARIO("Addition", "[tensor-addition]") {
             //REQUIRE(contracted() == 3);
         }
 
+        WHEN(" contracting metrics and epsilons") {
+            auto inverse = Construction::Language::API::InverseGamma({ {"a", {1,3}}, {"b", {1,3}} });
+            auto gamma = Construction::Tensor::Tensor::Gamma({ {"b", {1,3}}, {"c", {1,3}} });
+            auto trace = Construction::Tensor::Tensor::Gamma({ {"a", {1,3}}, {"b", {1,3}} });
+
+            auto epsilonA = Construction::Tensor::Tensor::Epsilon({ {"a", {1,3}}, {"b", {1,3}}, {"c", {1,3}} });
+            auto epsilonB = Construction::Tensor::Tensor::Epsilon({ {"a", {1,3}}, {"d", {1,3}}, {"e", {1,3}} });
+            auto epsilonC = Construction::Tensor::Tensor::Epsilon({ {"b", {1,3}}, {"a", {1,3}}, {"c", {1,3}} });
+
+            THEN(" we get deltas and numbers") {
+                REQUIRE((inverse * gamma).ToString() == "\\delta^{a}_{c}");
+                REQUIRE((inverse * trace).ToString() == "3");
+                REQUIRE((epsilonA * epsilonC).ToString() == "-6");
+                REQUIRE((inverse * epsilonB).ToString() == "\\epsilon^{b}_{de}");
+
+                auto contracted = epsilonA * epsilonB;
+                REQUIRE(contracted.IsAdded());
+                REQUIRE(contracted.ToString() == "\\delta^{b}_{d}\\delta^{c}_{e} - \\delta^{b}_{e}\\delta^{c}_{d}");
+                REQUIRE(contracted(1,1,2,2) == 1);
+                REQUIRE(contracted(1,2,2,1) == -1);
+                REQUIRE(contracted(1,1,1,1) == 0);
+            }
+        }
+
         WHEN(" adding them") {
 
             THEN(" we get the double") {
@@ -473,6 +711,95 @@ SCENARIO("Addition", "[tensor-addition]") {
 
         }
 
+        WHEN(" adding sums") {
+            auto permuted_gamma = Construction::Tensor::Tensor::Gamma({ { "b", {1,3} }, { "a", {1,3} } });
+
+            auto sum = a;
+            sum += permuted_gamma;
+            sum += a;
+
+            auto flat = Construction::Tensor::Tensor::Add({ a, permuted_gamma, a });
+
+            THEN(" we get one flat sum") {
+                REQUIRE(sum.GetSummands().size() == 5);
+                REQUIRE(flat.GetSummands().size() == 5);
+                REQUIRE(flat.ToString() == sum.ToString());
+            }
+
+            THEN(" we can add a sum to itself") {
+                sum += sum;
+                REQUIRE(sum.GetSummands().size() == 10);
+                REQUIRE(sum(1,1) == 10);
+            }
+        }
+
+        WHEN(" evaluating all the components at once") {
+            auto permuted_gamma = Construction::Tensor::Tensor::Gamma({ { "b", {1,3} }, { "a", {1,3} } });
+            auto product = gamma * Construction::Tensor::Tensor::Epsilon(Construction::Tensor::Indices::GetRomanSeries(3, {1,3}, 2));
+            auto sum = a + Construction::Tensor::Scalar(1,2) * permuted_gamma;
+
+            THEN(" we get the same as evaluating component by component") {
+                auto combinations = sum.GetAllIndexCombinations();
+                auto column = sum.EvaluateAll();
+
+                REQUIRE(column.size() == 9);
+                for (unsigned j=0; j<combinations.size(); j++) {
+                    REQUIRE(column[j] == sum(combinations[j]));
+                }
+
+                combinations = product.GetAllIndexCombinations();
+                column = product.EvaluateAll();
+
+                REQUIRE(column.size() == 243);
+                for (unsigned j=0; j<combinations.size(); j++) {
+                    REQUIRE(column[j] == product(combinations[j]));
+                }
+            }
+
+            THEN(" products with contracted or repeated indices agree with the components") {
+                using namespace Construction::Tensor;
+
+                Index e ("e", "e", Range(1,3)), d ("d", "d", Range(1,3));
+                Index eUp = e, dUp = d;
+                eUp.SetContravariant(true);
+                dUp.SetContravariant(true);
+
+                // The contracted index is the last one of the first and the first one of the second factor
+                MultipliedTensor contracted (ConstTensorPointer(new EpsilonTensor({ {"a", {1,3}}, {"b", {1,3}}, e })), ConstTensorPointer(new EpsilonTensor({ eUp, {"c", {1,3}}, d })));
+
+                // The second factor has the same index twice
+                MultipliedTensor repeated (ConstTensorPointer(new EpsilonTensor({ {"a", {1,3}}, {"b", {1,3}}, {"c", {1,3}} })), ConstTensorPointer(new GammaTensor({ d, dUp })));
+
+                for (auto tensor : { &contracted, &repeated }) {
+                    auto combinations = tensor->GetAllIndexCombinations();
+                    auto column = tensor->EvaluateAll();
+
+                    REQUIRE(column.size() == combinations.size());
+                    for (unsigned j=0; j<combinations.size(); j++) {
+                        REQUIRE(column[j] == (*tensor)(combinations[j]));
+                    }
+                }
+            }
+
+            THEN(" we can evaluate in a different index order") {
+                Construction::Tensor::Indices indices = { {"b", {1,3}}, {"a", {1,3}} };
+                std::vector<std::vector<unsigned>> combinations = { { 1, 2 }, { 2, 2 } };
+                auto column = gamma.EvaluateColumn(indices, combinations);
+
+                REQUIRE(column.size() == 2);
+                REQUIRE(column[0] == 0);
+                REQUIRE(column[1] == 1);
+            }
+
+            THEN(" the table of index combinations is shared") {
+                auto table = gamma.GetIndices().GetIndexCombinationTable();
+
+                REQUIRE(table->Size() == 9);
+                REQUIRE(table == permuted_gamma.GetIndices().GetIndexCombinationTable());
+                REQUIRE(table->ToVector() == gamma.GetAllIndexCombinations());
+            }
+        }
+
     }
 
 }